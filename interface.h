@@ -9,6 +9,8 @@
 ///ui32Prefix的几个预定义值
 #define U3V_PREFIX_COMMAND_PACKET   0x43563355  ///< 命令包
 #define U3V_PREFIX_EVENT_PACKET     0x45563355  ///< 事件包
+#define U3V_PREFIX_IMAGE_LEADER     0x4C563355  ///< 图像Leader
+#define U3V_PREFIX_IMAGE_TRAILER    0x54563355  ///< 图像Trailer
 
 ///U3V数据包command id的预定义值
 #define U3V_READ_MEM_CMD            0x800        ///< 读内存请求包
@@ -14,11 +14,18 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/stat.h> 
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <zlib.h>
 #include "interface.h"
 
 #define LOG_BLOCK_NUM               100000        //允许处理的命令模块数量，方便查看数据开始位置的处理结果
-#define CMD_LINE_NUM                100000       //存储命令模块的定义数组行数(应大于MODULE_LINE_MAX)
+#define CMD_LINE_NUM                8192         //存储U3V前缀模块(命令、Leader、Trailor)的数组行数，payload模块逐行处理不受此限制
 #define ROW_LENGTH                  200         //一行数据长度，可大于实际长度
 #define COMMOM_OVERFLOW             100         //通用溢出宏定义
 
@@ -27,12 +34,35 @@
 #define REGADDR_OFFSET              13          //REGADDR数据对Data首地址的偏移量
 #define ARR_CMD_PHASE_LENGTH        30          //CMD Phase字符数组size
 
-#define MAX_DEVICE_NUM              100         //最大设备device num
-#define MAX_ENDPOINT_NUM            5           //最大端口号
+#define DEV_ENP_MAP_INIT_SIZE       64          //设备端口映射表初始容量(必须为2的幂)
+#define DEV_ENP_NAME_SIZE           24          //"总线.设备.端口"名称字节长度
 
 #define READ_ACK_DATA_MAX           15           //READ CMD返回ACK中包含的data数据字节打印个数
 
 #define FILENAME_SIZE               100 		 //文件名字节长度
+#define INPUT_BUFFER_SIZE           (1 << 20)    //log文件读缓冲区字节数
+
+#define EVENT_RING_SIZE             4096         //每个设备事件时间线环形缓冲区条目数(必须为2的幂)
+#define EVENT_ID_STAT_NUM           32           //每个设备统计的事件ID种类上限
+#define EVENT_SCD_HEAD_LENGTH       12           //事件SCD中Reserved、EventID、Timestamp所占字节数
+
+#define PENDING_CMD_NUM             16           //每个设备记录的未应答命令数(必须为2的幂)，按RequestID低位索引
+#define FNV_OFFSET_BASIS            0xcbf29ce484222325ULL   //FNV-1a 64位初值
+#define FNV_PRIME                   0x100000001b3ULL        //FNV-1a 64位乘数
+#define DIFF_TABLE_INIT_SIZE        1024         //比对哈希表初始容量(必须为2的幂)
+#define REG_MAP_INIT_SIZE           256          //每个设备寄存器地址表初始容量(必须为2的幂)
+#define PROFILE_TOP_NUM             10           //默认输出的最频繁访问寄存器个数
+#define REG_NAME_SIZE               40           //寄存器名称字节长度
+#define FRAME_BUFFER_INIT_SIZE      (1 << 16)    //原始帧流每个端口帧缓冲区初始字节数
+#define RAW_FRAME_MAGIC             0x46563355   //原始帧流帧头标识"U3VF"
+#define CACHE_MAGIC                 "U3VCACHE"   //结果缓存文件标识
+#define CACHE_VERSION               4            //解析器版本，解析逻辑或输出格式改变时加1，使旧的结果缓存失效
+#define CACHE_SAMPLE_NUM            16           //计算输入文件内容指纹时均匀抽取的片段数
+#define CACHE_SAMPLE_SIZE           4096         //每个片段的字节数
+#define CACHE_COPY_SIZE             (1 << 16)    //从缓存回放文本时每次读取的字节数
+#define PNG_DEFAULT_LEVEL           6            //PNG默认zlib压缩级别(0~9)
+#define PNG_QUEUE_PER_THREAD        2            //PNG编码队列长度为编码线程数的倍数，队列满时解析线程等待
+#define PNG_IDAT_SIZE               (1 << 16)    //每个IDAT块的最大字节数
 
 //保存各数据段偏移量的结构体
 typedef struct LOCATION_OFFSET
@@ -55,19 +85,498 @@ typedef struct LOCATION_OFFSET
 //设备号端口号结构体
 typedef struct DEV_ENP_NUM
 {
-    uint8_t ui8DeviceNum;
-    uint8_t ui8EndpointNum;
+    uint16_t ui16BusNum;                            //总线号，Device段只有"设备.端口"时为0
+    uint16_t ui16DeviceNum;
+    uint16_t ui16EndpointNum;
 }DEV_ENP_NUM;
 
-//特定设备端口对应状态
+//流协议错误类型
+typedef enum STREAM_ERROR
+{
+    STREAM_ERR_RESIDUAL = 0,                        //未收到Leader的残帧数据
+    STREAM_ERR_NO_PAYLOAD,                          //Leader之后没有payload
+    STREAM_ERR_NO_TRAILER,                          //payload之后没有Trailor
+    STREAM_ERR_BLOCKID_MISMATCH,                    //Leader和Trailor BlockID不匹配
+    STREAM_ERR_PAYLOAD_SIZE,                        //payload总大小与Trailor不符
+    STREAM_ERR_BLOCKID_ORDER,                       //BlockID未单调递增
+    STREAM_ERR_BAD_HEX,                             //Data段存在非十六进制字符
+    STREAM_ERR_BLOCK_LENGTH,                        //payload模块转换得到的字节数与Length段不符
+    STREAM_ERR_BLOCK_OVERSIZE,                      //协议包模块超过CMD_LINE_NUM行，已跳过
+    STREAM_ERR_NUM
+}STREAM_ERROR;
+
+//不为NULL时FileSprintf输出的文本同时写入结果缓存
+FILE *g_fpTextCache = NULL;
+
+//与STREAM_ERROR对应的错误提示
+const char *g_arrStreamErrorMsg[STREAM_ERR_NUM] =
+{
+    "有残帧!!!",
+    "没有payload",
+    "没有Trailor，有残帧!!!",
+    "Leader和Trailor BlockID不匹配!!!",
+    "payload数据总大小不等于Trailor中的payload size!!!",
+    "BlockID未单调递增!!!",
+    "Data段存在非法字符!!!",
+    "payload模块数据与Length不符!!!",
+    "协议包模块行数超过CMD_LINE_NUM，已跳过!!!",
+};
+
+//一帧PNG编码任务，帧缓冲区由编码线程写完后释放
+typedef struct PNG_JOB
+{
+    char arrFileName[FILENAME_SIZE];
+    char *pData;                                    //帧payload
+    uint64_t ui64Size;
+    uint32_t ui32SizeX;
+    uint32_t ui32SizeY;
+    uint8_t ui8BitDepth;                            //8或16(16位像素按小端存放)
+}PNG_JOB;
+
+//PNG编码线程池，解析线程提交完整帧，队列有界
+typedef struct PNG_ENCODER
+{
+    pthread_t *pThread;
+    uint32_t ui32ThreadNum;
+    PNG_JOB *pQueue;                                //环形队列
+    uint32_t ui32QueueSize;
+    uint32_t ui32QueueHead;
+    uint32_t ui32QueueNum;
+    pthread_mutex_t stMutex;                        //保护队列和统计
+    pthread_cond_t stNotEmpty;
+    pthread_cond_t stNotFull;
+    bool bStop;                                     //不再提交任务，线程处理完队列后退出
+    int nLevel;                                     //zlib压缩级别
+    uint64_t ui64EncodedNum;                        //写入成功的帧数
+    uint64_t ui64FailNum;                           //写入失败的帧数
+}PNG_ENCODER;
+
+//运行选项
+typedef struct RUN_OPTION
+{
+    bool bValidate;                                 //只校验协议不变量，不输出图像和解析文本
+    bool bDiff;                                     //比对两个log的控制事务和图像内容
+    bool bProfile;                                  //统计寄存器访问，不输出图像和解析文本
+    uint32_t ui32TopNum;                            //寄存器统计输出的最频繁访问地址个数
+    const char *pRawStreamPath;                     //原始帧流输出路径，"-"为标准输出，NULL不输出
+    bool bRawHeader;                                //原始帧流每帧前加RAW_FRAME_HEADER
+    int nRawFd;                                     //已打开的原始帧流文件描述符，-1为不输出
+    bool bCache;                                    //使用结果缓存，输入和选项未变时不重新解析
+    uint32_t ui32FramesPerStream;                   //每个端口最多解析的帧数，0不限制
+    uint32_t ui32EveryNthFrame;                     //每个端口每K帧解析1帧，0或1为每帧
+    uint64_t ui64MaxBytes;                          //抽样帧payload总字节数达到后不再抽样，0不限制
+    bool bPng;                                      //图像输出为PNG，由编码线程池压缩
+    int nPngLevel;                                  //PNG zlib压缩级别
+    PNG_ENCODER *pPngEncoder;                       //已启动的PNG编码线程池，NULL输出PGM
+}RUN_OPTION;
+
+//原始帧流中每帧前的帧头(小端)，其后紧跟ui64PayloadSize字节payload
+typedef struct RAW_FRAME_HEADER
+{
+    uint32_t ui32Magic;                             //RAW_FRAME_MAGIC
+    uint16_t ui16HeaderSize;                        //sizeof(RAW_FRAME_HEADER)
+    uint16_t ui16BusNum;
+    uint16_t ui16DeviceNum;
+    uint16_t ui16EndpointNum;
+    uint32_t ui32PixelFormat;                       //以下取自IMAGE_LEADER
+    uint64_t ui64BlockID;
+    uint64_t ui64Timestamp;
+    uint32_t ui32SizeX;
+    uint32_t ui32SizeY;
+    uint64_t ui64PayloadSize;
+}RAW_FRAME_HEADER;
+
+//特定设备端口对应状态中每个模块都要访问的热数据，紧凑存放
 typedef struct DEV_ENP_STATUS
 {
     uint8_t ui8Status;								//设备端口对应状态
-    char arrCurrentFileName[FILENAME_SIZE];			//该设备端口对应的当前图像文件绝对打开路径
+    bool bSkipPayload;                              //当前帧未被抽样，payload只按Length段累计
     uint64_t ui64BlockID;
     uint64_t ui64PayloadSizeSum;
+    uint64_t ui64PayloadHash;                       //当前帧payload指纹
 }DEV_ENP_STATUS;
 
+//特定设备端口的冷数据，只在Leader、Trailor、出错和统计时访问
+typedef struct DEV_ENP_INFO
+{
+    DEV_ENP_NUM stDevEnpNum;
+    char arrCurrentFileName[FILENAME_SIZE];			//该设备端口对应的当前图像文件绝对打开路径
+    uint64_t ui64FrameCount;                        //已收到的ImageLeader数
+    uint64_t ui64SampledCount;                      //抽样解析的帧数
+    uint32_t arrErrCount[STREAM_ERR_NUM];           //各类协议错误计数
+    uint32_t ui32PixelFormat;                       //当前帧Leader中的像素格式
+    uint32_t ui32SizeX;
+    uint32_t ui32SizeY;
+    uint64_t ui64Timestamp;                         //当前帧Leader中的时间戳
+    char *pFrameBuffer;                             //原始帧流模式下拼接当前帧payload，帧间复用
+    uint64_t ui64FrameSize;
+    uint64_t ui64FrameBufferSize;
+    uint32_t ui32CacheFrame;                        //当前帧在结果缓存帧表中的下标+1，0为不记录
+}DEV_ENP_INFO;
+
+//键到稠密数组下标的开放寻址映射表
+typedef struct KEY_INDEX_MAP
+{
+    uint64_t *pKey;                                 //键+1，0表示空位
+    uint32_t *pIndex;                               //键对应的稠密数组下标
+    uint32_t ui32Capacity;                          //容量，2的幂
+    uint32_t ui32Size;
+}KEY_INDEX_MAP;
+
+//设备端口状态表，按首次出现顺序稠密存放，容量按需增长
+typedef struct DEV_ENP_TABLE
+{
+    KEY_INDEX_MAP stMap;                            //(总线, 设备, 端口)到下标
+    DEV_ENP_STATUS *pHot;                           //热数据
+    DEV_ENP_INFO *pCold;                            //冷数据，与pHot同下标
+    uint32_t ui32Num;
+    uint32_t ui32Capacity;
+    uint64_t ui64LastKey;                           //最近一次查找的键+1，连续模块多属于同一端口
+    uint32_t ui32LastIndex;
+}DEV_ENP_TABLE;
+
+//事件时间线条目，紧凑存储以便容纳大量事件
+typedef struct EVENT_ENTRY
+{
+    uint64_t ui64Timestamp;                         //事件时间戳
+    uint16_t ui16EventID;                           //事件ID
+    uint16_t ui16DataLength;                        //事件数据字节数
+    uint32_t ui32Data;                              //事件数据前4字节
+}EVENT_ENTRY;
+
+//单个事件ID到图像Leader的延时统计
+typedef struct EVENT_LATENCY_STAT
+{
+    uint16_t ui16EventID;
+    uint64_t ui64EventCount;                        //该ID事件总数
+    uint64_t ui64MatchCount;                        //已关联到Leader的事件数
+    uint64_t ui64LatencySum;                        //事件到Leader时间戳差值累加(设备时钟tick)
+    uint64_t ui64LatencyMin;
+    uint64_t ui64LatencyMax;
+}EVENT_LATENCY_STAT;
+
+//单个设备的事件时间线
+typedef struct EVENT_TIMELINE
+{
+    EVENT_ENTRY *pRing;                             //环形缓冲区，收到第一个事件时分配
+    uint64_t ui64Head;                              //已写入事件总数
+    uint64_t ui64Matched;                           //已与Leader关联(或被丢弃)的事件总数
+    uint64_t ui64Dropped;                           //未关联即被覆盖的事件数
+    uint64_t ui64LeaderCount;                       //该设备的ImageLeader数
+    uint16_t ui16StatNum;
+    EVENT_LATENCY_STAT arrStat[EVENT_ID_STAT_NUM];
+}EVENT_TIMELINE;
+
+//未应答的读写命令，用于将ACK关联到寄存器地址
+typedef struct PENDING_CMD
+{
+    bool bValid;
+    uint16_t ui16RequestID;
+    uint16_t ui16CommandID;
+    uint64_t ui64Address;
+}PENDING_CMD;
+
+//单个设备的状态(不区分端口)
+typedef struct DEVICE_STATUS
+{
+    DEV_ENP_NUM stDevEnpNum;                        //端口号为0
+    EVENT_TIMELINE stEventTimeline;                 //事件时间线
+    PENDING_CMD arrPendingCmd[PENDING_CMD_NUM];     //未应答命令
+}DEVICE_STATUS;
+
+//设备状态表，按首次出现顺序稠密存放，容量按需增长
+typedef struct DEVICE_TABLE
+{
+    KEY_INDEX_MAP stMap;                            //(总线, 设备)到下标
+    DEVICE_STATUS *pDevice;
+    uint32_t ui32Num;
+    uint32_t ui32Capacity;
+}DEVICE_TABLE;
+
+//模块Data段开头的前缀和CCD，用于判断模块类型
+typedef struct BLOCK_HEAD
+{
+    PREFIX stPrefix;
+    CCD_CMD stCCD;
+}BLOCK_HEAD;
+
+//事务记录类型
+typedef enum RECORD_TYPE
+{
+    RECORD_CONTROL = 0,                             //控制通道命令、应答及事件
+    RECORD_FRAME                                    //完整的一帧图像
+}RECORD_TYPE;
+
+//解码得到的事务记录，供不依赖文本输出的模式使用
+typedef struct U3V_RECORD
+{
+    uint8_t ui8Type;                                //RECORD_TYPE
+    DEV_ENP_NUM stDevEnpNum;
+    uint32_t ui32DeviceIndex;                       //设备在log中首次出现的序号
+    uint16_t ui16CommandID;                         //控制事务命令ID，帧记录为0
+    uint16_t ui16Status;                            //ACK状态码或Trailor状态
+    uint64_t ui64Key;                               //控制事务:寄存器地址(事件为EventID); 帧:BlockID
+    uint64_t ui64Length;                            //控制事务:读写字节数; 帧:payload总字节数
+    uint64_t ui64Hash;                              //数据指纹
+    uint32_t ui32PixelFormat;                       //帧记录:Leader中的像素格式和尺寸
+    uint32_t ui32SizeX;
+    uint32_t ui32SizeY;
+    uint64_t ui64BlockNum;                          //记录所在模块在log中的序号
+    uint64_t ui64Time;                              //记录所在模块的Time段(us)
+    uint64_t ui64WireLength;                        //记录所在模块的Length段字节数
+    uint64_t ui64Value;                             //控制事务:读到或写入数据的前8字节(小端)
+}U3V_RECORD;
+
+//事务记录回调
+typedef void (*RECORD_SINK)(void *pUser, const U3V_RECORD &stRecord);
+
+//log模块读取器，按CmdPhase编号切分模块
+typedef struct LOG_READER
+{
+    FILE *fpData;
+    char arrHeader[2][ROW_LENGTH];                  //字段名行和'----'行
+    char arrTemp[ROW_LENGTH];                       //已读入的下一模块首行
+    char arrCMP1[ARR_CMD_PHASE_LENGTH];             //当前模块的CmdPhase编号
+    uint16_t ui16CmdPhaseOff;                       //CmdPhase段中'.'的位置
+    bool bBlockRemain;                              //arrTemp是当前模块尚未读取的行
+    bool bOversize;                                 //当前U3V前缀模块超过CMD_LINE_NUM行，只读入了前CMD_LINE_NUM行
+    bool bEnd;                                      //已读到文件末尾，arrTemp无效
+    uint64_t ui64TempOffset;                        //arrTemp在log文件中的偏移
+    uint64_t ui64NextOffset;                        //arrTemp之后一行的偏移
+    uint64_t ui64BlockOffset;                       //当前模块首行的偏移
+}LOG_READER;
+
+//结果缓存文件头，其后依次为文本、帧表、payload模块表
+typedef struct CACHE_HEADER
+{
+    char arrMagic[8];                               //"U3VCACHE"
+    uint32_t ui32Version;                           //CACHE_VERSION
+    uint32_t ui32Reserved;
+    uint64_t ui64FileSize;                          //以下为输入文件指纹
+    int64_t i64MtimeSec;
+    int64_t i64MtimeNsec;
+    uint64_t ui64ContentHash;                       //均匀抽取CACHE_SAMPLE_NUM个片段的哈希
+    uint64_t ui64OptionHash;                        //影响输出的运行选项的哈希
+    LOCATION_OFFSET stOffset;                       //回放时转换payload行所需的各数据段偏移
+    uint64_t ui64ErrorCount;                        //协议错误总数与出错模块数之和
+    uint64_t ui64TextSize;                          //FileSprintf输出文本的字节数
+    uint32_t ui32FrameNum;
+    uint32_t ui32SpanNum;
+}CACHE_HEADER;
+
+//结果缓存中一帧图像的输出记录
+typedef struct CACHE_FRAME
+{
+    DEV_ENP_NUM stDevEnpNum;
+    uint32_t ui32PixelFormat;                       //Leader中的像素格式和尺寸
+    uint32_t ui32SizeX;
+    uint32_t ui32SizeY;
+    uint64_t ui64BlockID;
+    uint64_t ui64Timestamp;
+    bool bImage;                                    //输出图像文件arrFileName
+    bool bTrailer;                                  //收到Trailor，PNG在此时输出
+    bool bComplete;                                 //收到Trailor且校验通过，输出到原始帧流
+    char arrFileName[FILENAME_SIZE];
+}CACHE_FRAME;
+
+//结果缓存中一个payload模块在log文件中的位置，回放时直接定位转换
+typedef struct CACHE_SPAN
+{
+    uint64_t ui64Offset;                            //模块首行在log文件中的偏移
+    uint32_t ui32FrameIndex;                        //所属帧在帧表中的下标
+    uint32_t ui32LineNum;                           //模块行数
+    uint64_t ui64ValidSize;                         //计入图像的字节数
+}CACHE_SPAN;
+
+//正在生成的结果缓存
+typedef struct RESULT_CACHE
+{
+    CACHE_HEADER stHeader;
+    FILE *fpCache;                                  //缓存临时文件，文本直接写入
+    CACHE_FRAME *pFrame;
+    uint32_t ui32FrameCapacity;
+    CACHE_SPAN *pSpan;
+    uint32_t ui32SpanCapacity;
+}RESULT_CACHE;
+
+//单个log的解析上下文
+typedef struct LOG_CONTEXT
+{
+    LOCATION_OFFSET stOffset;                       //各数据段偏移量
+    char *pArrResultFileName;                       //解析结果文件路径，为NULL时只在控制台输出
+    bool bTextOutput;                               //输出命令、Leader、Trailor解析文本
+    bool bErrorOutput;                              //输出协议错误提示
+    bool bImageOutput;                              //写图像文件
+    bool bDecodePayload;                            //将payload数据段转换为字节
+    DEV_ENP_TABLE stDevEnpTable;                    //设备端口状态
+    DEVICE_TABLE stDeviceTable;                     //设备状态
+    RECORD_SINK pfnRecordSink;                      //事务记录回调，为NULL时不生成记录
+    void *pSinkUser;
+    LOG_READER *pReader;                            //payload模块其余行从读取器逐行读取
+    int nRawFd;                                     //原始帧流文件描述符，-1为不输出
+    bool bRawHeader;                                //原始帧流每帧前加帧头
+    uint32_t ui32FramesPerStream;                   //帧抽样条件，见RUN_OPTION
+    uint32_t ui32EveryNthFrame;
+    uint64_t ui64MaxBytes;
+    uint64_t ui64SampledFrames;                     //抽样解析的帧数
+    uint64_t ui64SampledBytes;                      //抽样帧payload的Length总和
+    RESULT_CACHE *pCache;                           //结果缓存，为NULL时不记录
+    BLOCK_HEAD stBlockHead;                         //当前模块首行开头的前缀和CCD，由LogReaderNext转换
+    PNG_ENCODER *pPngEncoder;                       //PNG编码线程池，为NULL时输出PGM
+    uint64_t ui64BlockNum;                          //已读取的模块数
+}LOG_CONTEXT;
+
+//单个寄存器地址的访问统计
+typedef struct REG_STAT
+{
+    uint64_t ui64Address;
+    uint64_t ui64ReadCount;
+    uint64_t ui64WriteCount;
+    uint64_t ui64Bytes;                             //读写命令请求的字节数
+    uint64_t ui64ErrorCount;                        //ACK状态码非0的次数
+    uint64_t ui64LastTime;                          //上次读写命令的时间(us)
+    uint64_t ui64IntervalSum;                       //相邻两次读写命令的间隔(us)
+    uint64_t ui64IntervalMin;
+    uint64_t ui64IntervalMax;
+}REG_STAT;
+
+//单个设备的寄存器访问直方图
+typedef struct REG_PROFILE
+{
+    DEV_ENP_NUM stDevEnpNum;
+    KEY_INDEX_MAP stMap;                            //寄存器地址 -> pStat下标，未使用时pKey为NULL
+    REG_STAT *pStat;
+    uint32_t ui32Num;
+    uint32_t ui32Capacity;
+    uint64_t ui64CommandNum;
+    uint64_t ui64AckNum;
+    uint64_t ui64UnmatchedAckNum;                   //找不到对应命令的ACK
+    uint64_t ui64ControlBytes;                      //U3VC命令和应答模块的Length总和
+    uint64_t ui64SbrmBase;                          //从ACK中得到的SBRM、SIRM、EIRM基址，0为未知
+    uint64_t ui64SirmBase;
+    uint64_t ui64EirmBase;
+}REG_PROFILE;
+
+//寄存器访问统计上下文
+typedef struct PROFILE_CONTEXT
+{
+    REG_PROFILE *pDevice;                           //按设备首次出现的序号索引
+    uint32_t ui32Num;
+    uint32_t ui32Capacity;
+    uint32_t ui32TopNum;
+    uint64_t ui64TotalBytes;                        //log中所有模块的Length总和
+}PROFILE_CONTEXT;
+
+//寄存器名称表项
+typedef struct REG_NAME
+{
+    uint64_t ui64Address;                           //ABRM中为绝对地址，SBRM中为相对基址的偏移
+    const char *pName;
+}REG_NAME;
+
+//ABRM(GenCP技术引导寄存器)
+const REG_NAME g_arrAbrmName[] =
+{
+    {0x0000, "GenCP Version"},
+    {0x0004, "Manufacturer Name"},
+    {0x0044, "Model Name"},
+    {0x0084, "Family Name"},
+    {0x00C4, "Device Version"},
+    {0x0104, "Manufacturer Info"},
+    {0x0144, "Serial Number"},
+    {0x0184, "User Defined Name"},
+    {0x01C4, "Device Capability"},
+    {0x01CC, "Max Device Response Time"},
+    {0x01D0, "Manifest Table Address"},
+    {SBRM_ADDR, "SBRM Address"},
+    {0x01E0, "Device Configuration"},
+    {0x01E8, "Heartbeat Timeout"},
+    {0x01EC, "Message Channel ID"},
+    {0x01F0, "Timestamp"},
+    {0x01F8, "Timestamp Latch"},
+    {0x01FC, "Timestamp Increment"},
+    {0x0204, "Access Privilege"},
+    {0x0208, "Protocol Endianess"},
+    {0x020C, "Implementation Endianess"},
+};
+
+//SBRM(U3V技术引导寄存器)
+const REG_NAME g_arrSbrmName[] =
+{
+    {0x00, "U3V Version"},
+    {0x04, "U3VCP Capability"},
+    {0x0C, "U3VCP Configuration"},
+    {0x14, "Max Command Transfer Length"},
+    {0x18, "Max Ack Transfer Length"},
+    {0x1C, "Number of Stream Channels"},
+    {0x20, "SIRM Address"},
+    {0x28, "SIRM Length"},
+    {EIRM_ADDR - SBRM_ADDR, "EIRM Address"},
+    {0x34, "EIRM Length"},
+    {0x38, "IIDC2 Address"},
+    {0x40, "Current Speed"},
+};
+
+//比对哈希表键：记录标识及相同标识的出现次序
+typedef struct DIFF_KEY
+{
+    uint8_t ui8Type;                                //RECORD_TYPE
+    uint32_t ui32DeviceOrder;                       //设备在log中出现的先后序号
+    uint16_t ui16EndpointNum;                       //帧记录的端口号，控制事务为0
+    uint16_t ui16CommandID;
+    uint64_t ui64Key;                               //寄存器地址、EventID或BlockID
+    uint32_t ui32Occurrence;                        //相同标识第几次出现，帧记录为端口BlockID回退次数
+}DIFF_KEY;
+
+//比对哈希表项
+typedef struct DIFF_ENTRY
+{
+    bool bUsed;
+    DIFF_KEY stKey;
+    U3V_RECORD stRecord;                            //尚未在另一log中找到对应的记录
+}DIFF_ENTRY;
+
+//开放寻址比对哈希表
+typedef struct DIFF_TABLE
+{
+    DIFF_ENTRY *pEntry;
+    uint64_t ui64Capacity;                          //容量，2的幂
+    uint64_t ui64Size;
+}DIFF_TABLE;
+
+//出现次数计数表项，只保存键和计数，表大小与不同控制事务标识数和端口数相关，与帧数无关
+typedef struct DIFF_COUNT
+{
+    bool bUsed;
+    DIFF_KEY stKey;                                 //帧记录按端口计数，ui64Key为0
+    uint32_t ui32Count;                             //控制事务、事件:相同标识已出现次数; 帧:BlockID回退(设备重启)次数
+    uint64_t ui64LastBlockID;                       //帧:该端口上一帧BlockID+1，0为尚未收到帧
+}DIFF_COUNT;
+
+//开放寻址出现次数计数表
+typedef struct DIFF_COUNT_TABLE
+{
+    DIFF_COUNT *pEntry;
+    uint64_t ui64Capacity;                          //容量，2的幂
+    uint64_t ui64Size;
+}DIFF_COUNT_TABLE;
+
+//比对中的一个log
+typedef struct DIFF_SIDE
+{
+    int nIndex;                                     //0 log A; 1 log B
+    struct DIFF_SIDE *pOther;                       //另一个log
+    FILE *fpData;
+    char **pArrStr;
+    LOG_READER stReader;
+    LOG_CONTEXT stContext;
+    DIFF_COUNT_TABLE stCountTable;                  //各标识已出现次数
+    DIFF_TABLE stPendingTable;                      //尚未匹配的记录
+    uint64_t ui64RecordNum;
+    uint64_t *pMatchNum;                            //两侧共享的匹配数
+    uint64_t *pDifferNum;                           //两侧共享的不一致数
+}DIFF_SIDE;
+
 //-----------------------------------------------------------
 /*
 \brief      根据'-'字符计算log文件中各数据字段的长度
@@ -88,617 +597,3617 @@ uint16_t CalSegLength(char *pSeg)
 
 //-----------------------------------------------------------
 /*
-\brief      获取设备号和端口号
+\brief      获取设备号和端口号，Device段格式为"设备.端口"或"总线.设备.端口"
 \parm[in]   pSrc    要分割的字符串指针
 \      
-\return     
+\return     0 成功; -1 格式错误或数值超出范围
 */
 //-----------------------------------------------------------
 int GetDevEnpNum(char *pSrc, DEV_ENP_NUM &stDevEnpNum)
 {
-    char *pDot = strchr(pSrc, '.');
-    char arrTemp[10];
-    if (pDot == NULL)
+    char *pEnd = NULL;
+    long arrNum[3] = {0, 0, 0};
+    int nNum = 0;
+    while (nNum < 3)
+    {
+        arrNum[nNum++] = strtol(pSrc, &pEnd, 10);
+        if ((pEnd == pSrc) || (arrNum[nNum - 1] < 0) || (arrNum[nNum - 1] > UINT16_MAX))
+        {
+            printf("Wrong Device Num!!!\n");
+            return -1;
+        }
+        if ((*pEnd != '.') || (pEnd[1] < '0') || (pEnd[1] > '9'))
+        {
+            break;
+        }
+        pSrc = pEnd + 1;
+    }
+    if (nNum < 2)
     {
         printf("Not find dot!!!\n");
         return -1;
     }
+
+    stDevEnpNum.ui16BusNum = (nNum == 3) ? (uint16_t)arrNum[0] : 0;
+    stDevEnpNum.ui16DeviceNum = (uint16_t)arrNum[nNum - 2];
+    stDevEnpNum.ui16EndpointNum = (uint16_t)arrNum[nNum - 1];
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief      生成设备端口名称"设备.端口"，有总线号时为"总线.设备.端口"
+\parm[in]   stDevEnpNum     设备号端口号
+\parm[in]   bWithEndpoint   是否包含端口号
+\parm[out]  pName           名称缓冲区，至少DEV_ENP_NAME_SIZE字节
+\return     pName
+*/
+//-----------------------------------------------------------
+const char *DevEnpName(const DEV_ENP_NUM &stDevEnpNum, bool bWithEndpoint, char *pName)
+{
+    int nLen = 0;
+    if (stDevEnpNum.ui16BusNum != 0)
+    {
+        nLen = sprintf(pName, "%d.", stDevEnpNum.ui16BusNum);
+    }
+    if (bWithEndpoint)
+    {
+        sprintf(pName + nLen, "%d.%d", stDevEnpNum.ui16DeviceNum, stDevEnpNum.ui16EndpointNum);
+    }
     else
     {
-        memcpy(arrTemp, pSrc, pDot - pSrc);
-        arrTemp[pDot - pSrc] = '\0';
-        stDevEnpNum.ui8DeviceNum = (uint8_t)strtol(arrTemp, NULL, 10);
-        stDevEnpNum.ui8EndpointNum = (uint8_t)strtol(pDot + 1, NULL, 10);
-        return 0;
+        sprintf(pName + nLen, "%d", stDevEnpNum.ui16DeviceNum);
     }
+    return pName;
 }
 
+//-----------------------------------------------------------
+/*
+\brief      设备端口映射表的键
+\parm[in]   stDevEnpNum     设备号端口号
+\parm[in]   bWithEndpoint   是否包含端口号，设备状态表不区分端口
+\return     键
+*/
+//-----------------------------------------------------------
+uint64_t DevEnpKey(const DEV_ENP_NUM &stDevEnpNum, bool bWithEndpoint)
+{
+    return ((uint64_t)stDevEnpNum.ui16BusNum << 32) | ((uint64_t)stDevEnpNum.ui16DeviceNum << 16)
+         | (bWithEndpoint ? stDevEnpNum.ui16EndpointNum : 0);
+}
 
 //-----------------------------------------------------------
 /*
-\brief      从单个命令模块中取出协议data数据，并转换为所代表实际数值存入字符串中，以用于协议结构体类型转换
-\parm[in]   pArrStr[][ROW_LENGTH]    单独一个模块的数据
-\parm[in]   nIndex                  模块的行数
-\parm[in]   stOffset                各数据段偏移量结构体
-\parm[out]  pCmdPacket              保存字符串转换为实际数值的数据
+\brief      初始化映射表
+\parm[in]   pMap            映射表
+\parm[in]   ui32Capacity    容量(必须为2的幂)
 \return     
 */
 //-----------------------------------------------------------
-int GetPacket(char **pArrStr, int nIndex, const LOCATION_OFFSET &stOffset, char *pCmdPacket)
+void KeyIndexMapInit(KEY_INDEX_MAP *pMap, uint32_t ui32Capacity)
 {
-    uint8_t ui8Temp = 0;
-    uint8_t ui8Count = 0;
-    for (int i = 0; i < nIndex; ++i)
+    pMap->pKey = new uint64_t[ui32Capacity];
+    memset(pMap->pKey, 0, ui32Capacity*sizeof(uint64_t));
+    pMap->pIndex = new uint32_t[ui32Capacity];
+    pMap->ui32Capacity = ui32Capacity;
+    pMap->ui32Size = 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief      释放映射表
+\parm[in]   pMap            映射表
+\return     无
+*/
+//-----------------------------------------------------------
+void KeyIndexMapRelease(KEY_INDEX_MAP *pMap)
+{
+    delete [] pMap->pKey;
+    pMap->pKey = NULL;
+    delete [] pMap->pIndex;
+    pMap->pIndex = NULL;
+}
+
+//-----------------------------------------------------------
+/*
+\brief      在映射表(线性探测)中查找键，不存在时以ui32NewIndex插入；装载率超过1/2时扩容
+\parm[in]   pMap            映射表
+\parm[in]   ui64Key         键
+\parm[in]   ui32NewIndex    键不存在时插入的下标
+\return     键对应的下标
+*/
+//-----------------------------------------------------------
+uint32_t KeyIndexMapGet(KEY_INDEX_MAP *pMap, uint64_t ui64Key, uint32_t ui32NewIndex)
+{
+    if ((pMap->ui32Size + 1) * 2 > pMap->ui32Capacity)
     {
-        for (int j = stOffset.ui16DataOff; j < stOffset.ui16DataOff+stOffset.ui16DataLength; ++j)
+        KEY_INDEX_MAP stOld = *pMap;
+        KeyIndexMapInit(pMap, stOld.ui32Capacity * 2);
+        for (uint32_t i = 0; i < stOld.ui32Capacity; ++i)
         {
-            ui8Temp = 0;
-            if ((pArrStr[i][j] >= '0') && (pArrStr[i][j] <= '9'))
-            {
-                ui8Temp = pArrStr[i][j] - '0';
-                ui8Count++;
-            }
-            else if((pArrStr[i][j] >= 'a') && (pArrStr[i][j] <= 'f'))
-            {
-                ui8Temp = 0x0a + pArrStr[i][j] - 'a';
-                ui8Count++;
-            }
-            else if ((pArrStr[i][j] >= 'A') && (pArrStr[i][j] <= 'F'))
-            {
-                ui8Temp = 0x0A + pArrStr[i][j] - 'A';
-                ui8Count++;
-            }
-            else if (pArrStr[i][j] == ' ')
-            {
-                continue;
-            }
-            else
+            if (stOld.pKey[i] != 0)
             {
-                printf("Wrong Num!\n");
-                return -1;   
+                KeyIndexMapGet(pMap, stOld.pKey[i] - 1, stOld.pIndex[i]);
             }
+        }
+        KeyIndexMapRelease(&stOld);
+    }
 
-            if(ui8Count%2 != 0)
-            {
-                *pCmdPacket = ui8Temp;
-            }   
-            else
-            {
-                *pCmdPacket = ((*pCmdPacket) << 4) | ui8Temp;
-                pCmdPacket++;
-            }
+    uint32_t ui32Mask = pMap->ui32Capacity - 1;
+    uint32_t ui32Pos = (uint32_t)((ui64Key * 0x9e3779b97f4a7c15ULL) >> 32) & ui32Mask;
+    while (pMap->pKey[ui32Pos] != 0)
+    {
+        if (pMap->pKey[ui32Pos] == ui64Key + 1)
+        {
+            return pMap->pIndex[ui32Pos];
         }
+        ui32Pos = (ui32Pos + 1) & ui32Mask;
     }
-    return 0;
+    pMap->pKey[ui32Pos] = ui64Key + 1;
+    pMap->pIndex[ui32Pos] = ui32NewIndex;
+    pMap->ui32Size++;
+    return ui32NewIndex;
 }
 
 //-----------------------------------------------------------
 /*
-\brief		打开图像文件，追加写入数据
-\parm   	pArrStr 				动态二维数组存储模块内容
-\parm   	nIndex					二维数组中有效数据行数
-\parm   	pArrDevEnpInfo			设备端口状态
-\parm 		stOffset				各数据段偏移量结构体	
-\parm　		stDevEnpNum				当前模块设备号和端口号
-\return		
+\brief      扩大稠密数组容量，新增部分清零
+\parm[in]   pOld            原数组，可为NULL
+\parm[in]   ui32Num         原数组有效元素数
+\parm[in]   ui32Capacity    新容量
+\parm[in]   nElemSize       元素字节数
+\return     新数组
 */
 //-----------------------------------------------------------
-uint64_t WriteByteToImg(char **pArrStr, int nIndex, DEV_ENP_STATUS (*pArrDevEnpInfo)[MAX_ENDPOINT_NUM], const LOCATION_OFFSET &stOffset, const DEV_ENP_NUM &stDevEnpNum)
+void *GrowArray(void *pOld, uint32_t ui32Num, uint32_t ui32Capacity, size_t nElemSize)
 {
-	//payload写入文件
-    FILE *fpImage = fopen(pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].arrCurrentFileName, "a+");
-    if (fpImage == NULL)
+    char *pNew = new char[ui32Capacity*nElemSize];
+    if (pOld != NULL)
     {
-        printf("Open image file fail!!!\n");
-        return 0;
+        memcpy(pNew, pOld, ui32Num*nElemSize);
     }
-    //计算当前payload size
-    char arrLength[30] = {0};
-    memcpy(arrLength, pArrStr[0] + stOffset.ui16LenOff, stOffset.ui16LenLength);
-    arrLength[stOffset.ui16LenLength] = '\0';
-    uint32_t ui16PayloadSize = strtol(arrLength, NULL, 10);
-
-    char *pImgPayLoad = new char[nIndex*ROW_LENGTH];
-    GetPacket(pArrStr, nIndex, stOffset, pImgPayLoad);
-    uint32_t ui32WriteByte = fwrite(pImgPayLoad, ui16PayloadSize, 1, fpImage);
-    printf("ActualWriteByte = %d\n", ui32WriteByte*ui16PayloadSize);
-    fclose(fpImage);
-    fpImage = NULL;
-
-    delete pImgPayLoad;
-    pImgPayLoad = NULL;
-    return (ui32WriteByte*ui16PayloadSize);
+    memset(pNew + ui32Num*nElemSize, 0, (ui32Capacity - ui32Num)*nElemSize);
+    delete [] (char *)pOld;
+    return pNew;
 }
 
 //-----------------------------------------------------------
 /*
-\brief		打开文本文件，追加写入log解析结果
-\parm   	pArrResultFileName 			文本文件绝对路径
-\parm   	pFileLineContent			计划写入文件的字符串数据
-\return		写入状态
+\brief      获取设备端口在状态表中的下标，首次出现时新建(状态清零)
+\parm[in]   pTable          设备端口状态表
+\parm[in]   stDevEnpNum     设备号端口号
+\return     下标，pHot和pCold同下标；表增长后原有指针失效
 */
 //-----------------------------------------------------------
-int WriteToFile(char *pArrResultFileName, char *pFileLineContent)
+uint32_t DevEnpTableGet(DEV_ENP_TABLE *pTable, const DEV_ENP_NUM &stDevEnpNum)
 {
-	FILE *fp = fopen(pArrResultFileName, "a+");
-    if (fp == NULL)
+    uint64_t ui64Key = DevEnpKey(stDevEnpNum, true);
+    if (pTable->ui64LastKey == ui64Key + 1)
     {
-        printf("Open File Fail !!!\n");
-        return -1;
+        return pTable->ui32LastIndex;
     }
-    int status = fputs(pFileLineContent, fp);
-    if (status == -1)
+
+    uint32_t ui32Index = KeyIndexMapGet(&pTable->stMap, ui64Key, pTable->ui32Num);
+    if (ui32Index == pTable->ui32Num)   //新端口
     {
-    	printf("Write File Fail!!!\n");
-    	return -1;
+        if (pTable->ui32Num == pTable->ui32Capacity)
+        {
+            uint32_t ui32Capacity = (pTable->ui32Capacity == 0) ? DEV_ENP_MAP_INIT_SIZE : pTable->ui32Capacity * 2;
+            pTable->pHot = (DEV_ENP_STATUS *)GrowArray(pTable->pHot, pTable->ui32Num, ui32Capacity, sizeof(DEV_ENP_STATUS));
+            pTable->pCold = (DEV_ENP_INFO *)GrowArray(pTable->pCold, pTable->ui32Num, ui32Capacity, sizeof(DEV_ENP_INFO));
+            pTable->ui32Capacity = ui32Capacity;
+        }
+        pTable->pCold[ui32Index].stDevEnpNum = stDevEnpNum;
+        pTable->ui32Num++;
     }
-
-    fclose(fp);
-    fp = NULL;
-    return 0;
+    pTable->ui64LastKey = ui64Key + 1;
+    pTable->ui32LastIndex = ui32Index;
+    return ui32Index;
 }
 
 //-----------------------------------------------------------
 /*
-\brief		将格式字符串（可变参数）在控制台打印，并写入对应路径文件
-\parm   	
-\parm   	
-\parm   	
-\parm 			
-\parm　		
-\return		
+\brief      获取设备状态，首次出现时新建(状态清零)
+\parm[in]   pTable          设备状态表
+\parm[in]   stDevEnpNum     设备号端口号，忽略端口号
+\return     设备状态指针，表增长后原有指针失效
 */
 //-----------------------------------------------------------
-int FileSprintf(char *pArrResultFileName, const char *format, ...)
+DEVICE_STATUS *DeviceTableGet(DEVICE_TABLE *pTable, const DEV_ENP_NUM &stDevEnpNum)
 {
-	char pOutBuffer[ROW_LENGTH];
-	va_list ap;  //用于保存可变参数
-	va_start(ap, format);
-	vsprintf(pOutBuffer, format, ap);
-	va_end(ap);
-
-	WriteToFile(pArrResultFileName, pOutBuffer);    //写入文件
-	printf("%s", pOutBuffer);						//控制台打印
-	return 0;
+    uint32_t ui32Index = KeyIndexMapGet(&pTable->stMap, DevEnpKey(stDevEnpNum, false), pTable->ui32Num);
+    if (ui32Index == pTable->ui32Num)   //新设备
+    {
+        if (pTable->ui32Num == pTable->ui32Capacity)
+        {
+            uint32_t ui32Capacity = (pTable->ui32Capacity == 0) ? DEV_ENP_MAP_INIT_SIZE : pTable->ui32Capacity * 2;
+            pTable->pDevice = (DEVICE_STATUS *)GrowArray(pTable->pDevice, pTable->ui32Num, ui32Capacity, sizeof(DEVICE_STATUS));
+            pTable->ui32Capacity = ui32Capacity;
+        }
+        pTable->pDevice[ui32Index].stDevEnpNum = stDevEnpNum;
+        pTable->pDevice[ui32Index].stDevEnpNum.ui16EndpointNum = 0;
+        pTable->ui32Num++;
+    }
+    return &pTable->pDevice[ui32Index];
 }
 
 //-----------------------------------------------------------
 /*
-\brief  单模块解析
-\parm   arrStr[][ROW_LENGTH]        单独一个模块的数据
-\parm   index                       模块的行数
-\parm   stOffset                      各数据段偏移量结构体
-\return
+\brief      将一行的Data段转换为实际数值
+\parm[in]   pLine                   一行数据
+\parm[in]   stOffset                各数据段偏移量结构体
+\parm[out]  pDst                    保存转换得到的字节
+\parm[in]   nMaxByte                最多转换的字节数
+\parm[out]  bWrongNum               Data段存在非法字符时置true，该行其余部分被跳过
+\return     转换得到的字节数
 */
 //-----------------------------------------------------------
-int CodeToCMD(char **pArrStr, int nIndex, const LOCATION_OFFSET &stOffset, char *pArrResultFileName)
+int GetLineBytes(const char *pLine, const LOCATION_OFFSET &stOffset, char *pDst, int nMaxByte, bool &bWrongNum)
 {
-    uint64_t ui64Temp = 0;
-    uint16_t ui16Temp = 0;
-    uint64_t ui64ADDR = 0;
-    uint16_t ui16CMDID = 0;
-    char arrDescript[DESCRIPTION_LENGTH];
-    char *pCmdPacket = new char[nIndex*ROW_LENGTH];
-    
-    GetPacket(pArrStr, nIndex, stOffset, pCmdPacket);
-    READ_MEM_CMD *pCMD = (READ_MEM_CMD *)pCmdPacket;
-
-    if (pCMD->m_stPrefix.ui32Prefix == U3V_PREFIX_COMMAND_PACKET) //判断是否为U3VC
+    uint8_t ui8Temp = 0;
+    uint8_t ui8Count = 0;
+    int nByteNum = 0;
+    for (int j = stOffset.ui16DataOff; (j < stOffset.ui16DataOff+stOffset.ui16DataLength) && (nByteNum < nMaxByte); ++j)
     {
-        if (pCMD->m_stCCDCmd.ui16CommandID == U3V_READ_MEM_CMD)   
-        {   
-            READ_MEM_CMD *pstReadMemCMD = (READ_MEM_CMD *)pCmdPacket;
-            FileSprintf(pArrResultFileName, "#READ CMD:  PREFIX:0x%x Flags:0x%x CommandID:0x%x RequestID:0x%x Address:0x%llx ReadLength:0x%x\n\n", pstReadMemCMD->m_stPrefix.ui32Prefix
-                                                                                                   , pstReadMemCMD->m_stCCDCmd.ui16Flag                 
-                                                                                                   , pstReadMemCMD->m_stCCDCmd.ui16CommandID
-                                                                                                   , pstReadMemCMD->m_stCCDCmd.ui16RequestID
-                                                                                                   , pstReadMemCMD->m_stSCDReadMemCmd.ui64RegisterAddress
-                                                                                                   , pstReadMemCMD->m_stSCDReadMemCmd.ui16ReadLength);
+        ui8Temp = 0;
+        if ((pLine[j] >= '0') && (pLine[j] <= '9'))
+        {
+            ui8Temp = pLine[j] - '0';
+            ui8Count++;
         }
-        else if (pCMD->m_stCCDCmd.ui16CommandID == U3V_READ_MEM_ACK)  //RACK
+        else if((pLine[j] >= 'a') && (pLine[j] <= 'f'))
         {
-            READ_MEM_ACK *pstReadMemACK = (READ_MEM_ACK *)pCmdPacket;
-            FileSprintf(pArrResultFileName, "#READ ACK:  PREFIX:0x%x Status:0x%x CommandID:0x%x RequestID:0x%x SCDLength:0x%x SCDData:", pstReadMemACK->m_stPrefix.ui32Prefix
-                                                                                                    , pstReadMemACK->m_stCCDAck.ui16StatusCode
-                                                                                                    , pstReadMemACK->m_stCCDAck.ui16CommandID
-                                                                                                    , pstReadMemACK->m_stCCDAck.ui16RequestID
-                                                                                                    , pstReadMemACK->m_stCCDAck.ui16Length);
-            uint64_t *pui64Temp = NULL;
-            if (pstReadMemACK->m_stCCDAck.ui16Length == 8)
-            {
-                pui64Temp = (uint64_t *)pstReadMemACK->m_stSCDReadMemAck.arrData;
-                FileSprintf(pArrResultFileName, "0x%llx 0x%llx", (*pui64Temp) >> 32, (*pui64Temp) & 0x0000ffff);
-            }
-            else if (pstReadMemACK->m_stCCDAck.ui16Length == 4)
-            {
-                pui64Temp = (uint64_t *)pstReadMemACK->m_stSCDReadMemAck.arrData;
-                FileSprintf(pArrResultFileName, "0x%llx", (*pui64Temp) & 0x0000ffff);
-            }
-            else
-            {
-                FileSprintf(pArrResultFileName, "0x");
-                for (int i = 0; i < pstReadMemACK->m_stCCDAck.ui16Length; ++i)
-                {
-                    FileSprintf(pArrResultFileName, "%02x", pstReadMemACK->m_stSCDReadMemAck.arrData[i]);
+            ui8Temp = 0x0a + pLine[j] - 'a';
+            ui8Count++;
+        }
+        else if ((pLine[j] >= 'A') && (pLine[j] <= 'F'))
+        {
+            ui8Temp = 0x0A + pLine[j] - 'A';
+            ui8Count++;
+        }
+        else if (pLine[j] == ' ')
+        {
+            continue;
+        }
+        else if ((pLine[j] == '\0') || (pLine[j] == '\n') || (pLine[j] == '\r'))  //行比Data段短
+        {
+            break;
+        }
+        else
+        {
+            bWrongNum = true;
+            break;
+        }
+
+        if(ui8Count%2 != 0)
+        {
+            pDst[nByteNum] = ui8Temp;
+        }   
+        else
+        {
+            pDst[nByteNum] = (pDst[nByteNum] << 4) | ui8Temp;
+            nByteNum++;
+        }
+    }
+    return nByteNum;
+}
+
+//-----------------------------------------------------------
+/*
+\brief      从单个命令模块中取出协议data数据，并转换为所代表实际数值存入字符串中，以用于协议结构体类型转换
+\parm[in]   pArrStr[][ROW_LENGTH]    单独一个模块的数据
+\parm[in]   nIndex                  模块的行数
+\parm[in]   stOffset                各数据段偏移量结构体
+\parm[out]  pCmdPacket              保存字符串转换为实际数值的数据
+\return     转换得到的字节数; -1 Data段存在非法字符(该行其余部分被跳过，其它行照常转换)
+*/
+//-----------------------------------------------------------
+int GetPacket(char **pArrStr, int nIndex, const LOCATION_OFFSET &stOffset, char *pCmdPacket)
+{
+    int nByteNum = 0;
+    bool bWrongNum = false;
+    for (int i = 0; i < nIndex; ++i)
+    {
+        bool bLineWrongNum = false;
+        nByteNum += GetLineBytes(pArrStr[i], stOffset, pCmdPacket + nByteNum, ROW_LENGTH, bLineWrongNum);
+        if (bLineWrongNum)
+        {
+            printf("Wrong Num!\n");
+            bWrongNum = true;
+        }
+    }
+    return bWrongNum ? -1 : nByteNum;
+}
+
+//-----------------------------------------------------------
+/*
+\brief      只转换模块首行Data段开头的前缀和CCD，用于判断模块类型，不转换整个模块
+\parm[in]   pLine                   模块首行
+\parm[in]   stOffset                各数据段偏移量结构体
+\parm[out]  pHead                   前缀和CCD，首行不足的字节为0
+\return     前缀，首行不足4字节时为0
+*/
+//-----------------------------------------------------------
+uint32_t GetBlockHead(const char *pLine, const LOCATION_OFFSET &stOffset, BLOCK_HEAD *pHead)
+{
+    bool bWrongNum = false;
+    memset(pHead, 0, sizeof(BLOCK_HEAD));
+    if (GetLineBytes(pLine, stOffset, (char *)pHead, sizeof(BLOCK_HEAD), bWrongNum) < (int)sizeof(PREFIX))
+    {
+        pHead->stPrefix.ui32Prefix = 0;
+    }
+    return pHead->stPrefix.ui32Prefix;
+}
+
+//-----------------------------------------------------------
+/*
+\brief      判断是否为U3V命令包、事件包、Leader或Trailor的完整4字节前缀
+\parm[in]   ui32Prefix              模块Data段开头4字节
+\return     true U3V协议包前缀
+*/
+//-----------------------------------------------------------
+bool IsU3VPrefix(uint32_t ui32Prefix)
+{
+    return (ui32Prefix == U3V_PREFIX_COMMAND_PACKET) || (ui32Prefix == U3V_PREFIX_EVENT_PACKET)
+        || (ui32Prefix == U3V_PREFIX_IMAGE_LEADER) || (ui32Prefix == U3V_PREFIX_IMAGE_TRAILER);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		读取模块首行Length段中的字节数
+\parm   	pLine					模块首行
+\parm 		stOffset				各数据段偏移量结构体
+\return		模块数据字节数
+*/
+//-----------------------------------------------------------
+uint32_t GetBlockLength(const char *pLine, const LOCATION_OFFSET &stOffset)
+{
+    char arrLength[30] = {0};
+    memcpy(arrLength, pLine + stOffset.ui16LenOff, stOffset.ui16LenLength);
+    arrLength[stOffset.ui16LenLength] = '\0';
+    return strtol(arrLength, NULL, 10);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		获取模块的时间，Time段格式为"[时:]分:秒.毫秒.微秒"
+\parm   	pLine					模块首行
+\parm   	stOffset				各数据段偏移量
+\return		时间(us)
+*/
+//-----------------------------------------------------------
+uint64_t GetBlockTime(const char *pLine, const LOCATION_OFFSET &stOffset)
+{
+    char arrTime[30] = {0};
+    memcpy(arrTime, pLine + stOffset.ui16TimeOff, stOffset.ui16TimeLength);
+    arrTime[stOffset.ui16TimeLength] = '\0';
+
+    char *pEnd = NULL;
+    uint64_t ui64Second = strtol(arrTime, &pEnd, 10);
+    while (*pEnd == ':')
+    {
+        ui64Second = ui64Second * 60 + strtol(pEnd + 1, &pEnd, 10);
+    }
+    uint64_t ui64Time = ui64Second * 1000000;
+    for (uint64_t ui64Scale = 1000; (ui64Scale != 0) && (*pEnd == '.'); ui64Scale /= 1000)
+    {
+        ui64Time += strtol(pEnd + 1, &pEnd, 10) * ui64Scale;
+    }
+    return ui64Time;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		FNV-1a 64位哈希，可分段连续计算
+\parm   	ui64Hash				上一段的哈希值，首段传入FNV_OFFSET_BASIS
+\parm   	pData					数据
+\parm   	ui64Length				数据字节数
+\return		累计哈希值
+*/
+//-----------------------------------------------------------
+uint64_t HashBytes(uint64_t ui64Hash, const void *pData, uint64_t ui64Length)
+{
+    const uint8_t *pByte = (const uint8_t *)pData;
+    for (uint64_t i = 0; i < ui64Length; ++i)
+    {
+        ui64Hash = (ui64Hash ^ pByte[i]) * FNV_PRIME;
+    }
+    return ui64Hash;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		读入下一行，判断是否仍属于当前模块
+\parm   	pReader					log模块读取器
+\parm   	stOffset				各数据段偏移量
+\return		true 新行属于当前模块; false 新行是下一模块首行或已到文件末尾
+*/
+//-----------------------------------------------------------
+bool LogReaderAdvance(LOG_READER *pReader, const LOCATION_OFFSET &stOffset)
+{
+    char arrCMP2[ARR_CMD_PHASE_LENGTH];
+    memset(pReader->arrTemp, 0, ROW_LENGTH*sizeof(char));
+    if (fgets(pReader->arrTemp, ROW_LENGTH, pReader->fpData) == NULL)
+    {
+        pReader->bEnd = true;
+        return false;
+    }
+    pReader->ui64TempOffset = pReader->ui64NextOffset;
+    pReader->ui64NextOffset += strlen(pReader->arrTemp);
+    memcpy(arrCMP2, pReader->arrTemp + stOffset.ui16CmdPhaseOff, pReader->ui16CmdPhaseOff);
+    arrCMP2[pReader->ui16CmdPhaseOff] = '\0';
+    if (strcmp(pReader->arrCMP1, arrCMP2) == 0)
+    {
+        return true;
+    }
+    strcpy(pReader->arrCMP1, arrCMP2);
+    return false;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		读取当前模块的下一行
+\parm   	pReader					log模块读取器
+\parm   	stOffset				各数据段偏移量
+\parm   	pLine					输出该行，至少ROW_LENGTH字节
+\return		0 读到一行; 1 当前模块已结束
+*/
+//-----------------------------------------------------------
+int LogReaderNextLine(LOG_READER *pReader, const LOCATION_OFFSET &stOffset, char *pLine)
+{
+    if ((pReader == NULL) || !pReader->bBlockRemain)
+    {
+        return 1;
+    }
+    memcpy(pLine, pReader->arrTemp, ROW_LENGTH);
+    pReader->bBlockRemain = LogReaderAdvance(pReader, stOffset);
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		打开文本文件，追加写入log解析结果
+\parm   	pArrResultFileName 			文本文件绝对路径
+\parm   	pFileLineContent			计划写入文件的字符串数据
+\return		写入状态
+*/
+//-----------------------------------------------------------
+int WriteToFile(char *pArrResultFileName, char *pFileLineContent)
+{
+	FILE *fp = fopen(pArrResultFileName, "a+");
+    if (fp == NULL)
+    {
+        printf("Open File Fail !!!\n");
+        return -1;
+    }
+    int status = fputs(pFileLineContent, fp);
+    if (status == -1)
+    {
+    	printf("Write File Fail!!!\n");
+    	return -1;
+    }
+
+    fclose(fp);
+    fp = NULL;
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		将格式字符串（可变参数）在控制台打印，并写入对应路径文件
+\parm   	
+\parm   	
+\parm   	
+\parm 			
+\parm　		
+\return		
+*/
+//-----------------------------------------------------------
+int FileSprintf(char *pArrResultFileName, const char *format, ...)
+{
+	char pOutBuffer[ROW_LENGTH];
+	va_list ap;  //用于保存可变参数
+	va_start(ap, format);
+	vsprintf(pOutBuffer, format, ap);
+	va_end(ap);
+
+	if (pArrResultFileName != NULL)
+	{
+		WriteToFile(pArrResultFileName, pOutBuffer);    //写入文件
+	}
+	if (g_fpTextCache != NULL)
+	{
+		fputs(pOutBuffer, g_fpTextCache);               //写入结果缓存
+	}
+	printf("%s", pOutBuffer);						//控制台打印
+	return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		将payload追加到端口的帧缓冲区，容量不足时加倍
+\parm   	pDevEnpInfo				当前设备端口信息
+\parm   	pData					payload数据
+\parm   	ui64Size				payload字节数
+\return
+*/
+//-----------------------------------------------------------
+void FrameBufferAppend(DEV_ENP_INFO *pDevEnpInfo, const char *pData, uint64_t ui64Size)
+{
+    if (pDevEnpInfo->ui64FrameSize + ui64Size > pDevEnpInfo->ui64FrameBufferSize)
+    {
+        uint64_t ui64BufferSize = (pDevEnpInfo->ui64FrameBufferSize == 0) ? FRAME_BUFFER_INIT_SIZE : pDevEnpInfo->ui64FrameBufferSize;
+        while (ui64BufferSize < pDevEnpInfo->ui64FrameSize + ui64Size)
+        {
+            ui64BufferSize *= 2;
+        }
+        char *pBuffer = new char[ui64BufferSize];
+        memcpy(pBuffer, pDevEnpInfo->pFrameBuffer, pDevEnpInfo->ui64FrameSize);
+        delete [] pDevEnpInfo->pFrameBuffer;
+        pDevEnpInfo->pFrameBuffer = pBuffer;
+        pDevEnpInfo->ui64FrameBufferSize = ui64BufferSize;
+    }
+    memcpy(pDevEnpInfo->pFrameBuffer + pDevEnpInfo->ui64FrameSize, pData, ui64Size);
+    pDevEnpInfo->ui64FrameSize += ui64Size;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		将完整的一帧(可选帧头 + payload)一次writev写入原始帧流，写入失败后关闭原始帧流
+\parm   	pContext				log解析上下文
+\parm   	pDevEnpInfo				当前设备端口信息，帧缓冲区中为该帧payload
+\parm   	ui64BlockID				该帧BlockID
+\return		0 成功; -1 写入失败
+*/
+//-----------------------------------------------------------
+int RawStreamWriteFrame(LOG_CONTEXT *pContext, DEV_ENP_INFO *pDevEnpInfo, uint64_t ui64BlockID)
+{
+    RAW_FRAME_HEADER stHeader;
+    memset(&stHeader, 0, sizeof(RAW_FRAME_HEADER));
+    stHeader.ui32Magic = RAW_FRAME_MAGIC;
+    stHeader.ui16HeaderSize = sizeof(RAW_FRAME_HEADER);
+    stHeader.ui16BusNum = pDevEnpInfo->stDevEnpNum.ui16BusNum;
+    stHeader.ui16DeviceNum = pDevEnpInfo->stDevEnpNum.ui16DeviceNum;
+    stHeader.ui16EndpointNum = pDevEnpInfo->stDevEnpNum.ui16EndpointNum;
+    stHeader.ui32PixelFormat = pDevEnpInfo->ui32PixelFormat;
+    stHeader.ui64BlockID = ui64BlockID;
+    stHeader.ui64Timestamp = pDevEnpInfo->ui64Timestamp;
+    stHeader.ui32SizeX = pDevEnpInfo->ui32SizeX;
+    stHeader.ui32SizeY = pDevEnpInfo->ui32SizeY;
+    stHeader.ui64PayloadSize = pDevEnpInfo->ui64FrameSize;
+
+    struct iovec arrIov[2];
+    int nIovNum = 0;
+    if (pContext->bRawHeader)
+    {
+        arrIov[nIovNum].iov_base = &stHeader;
+        arrIov[nIovNum++].iov_len = sizeof(RAW_FRAME_HEADER);
+    }
+    arrIov[nIovNum].iov_base = pDevEnpInfo->pFrameBuffer;
+    arrIov[nIovNum++].iov_len = pDevEnpInfo->ui64FrameSize;
+
+    //管道可能只写入一部分，从未写完处继续
+    struct iovec *pIov = arrIov;
+    while (nIovNum > 0)
+    {
+        ssize_t nWrite = writev(pContext->nRawFd, pIov, nIovNum);
+        if (nWrite < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            printf("Raw stream write fail: %s\n", strerror(errno));
+            pContext->nRawFd = -1;
+            return -1;
+        }
+        while ((nIovNum > 0) && ((size_t)nWrite >= pIov->iov_len))
+        {
+            nWrite -= pIov->iov_len;
+            pIov++;
+            nIovNum--;
+        }
+        if (nIovNum > 0)
+        {
+            pIov->iov_base = (char *)pIov->iov_base + nWrite;
+            pIov->iov_len -= nWrite;
+        }
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		在结果缓存中登记收到Leader的抽样帧
+\parm   	pCache					结果缓存
+\parm   	pDevEnpInfo				当前设备端口信息，已保存Leader中的像素格式、尺寸和时间戳
+\parm   	ui64BlockID				该帧BlockID
+\parm   	pFileName				该帧图像文件路径，不输出图像时为NULL
+\return		帧表下标+1，保存到DEV_ENP_INFO::ui32CacheFrame
+*/
+//-----------------------------------------------------------
+uint32_t CacheAddFrame(RESULT_CACHE *pCache, const DEV_ENP_INFO *pDevEnpInfo, uint64_t ui64BlockID, const char *pFileName)
+{
+    CACHE_HEADER *pHeader = &pCache->stHeader;
+    if (pHeader->ui32FrameNum >= pCache->ui32FrameCapacity)
+    {
+        uint32_t ui32Capacity = (pCache->ui32FrameCapacity == 0) ? DEV_ENP_MAP_INIT_SIZE : pCache->ui32FrameCapacity * 2;
+        pCache->pFrame = (CACHE_FRAME *)GrowArray(pCache->pFrame, pHeader->ui32FrameNum, ui32Capacity, sizeof(CACHE_FRAME));
+        pCache->ui32FrameCapacity = ui32Capacity;
+    }
+
+    CACHE_FRAME *pFrame = &pCache->pFrame[pHeader->ui32FrameNum++];
+    pFrame->stDevEnpNum = pDevEnpInfo->stDevEnpNum;
+    pFrame->ui32PixelFormat = pDevEnpInfo->ui32PixelFormat;
+    pFrame->ui32SizeX = pDevEnpInfo->ui32SizeX;
+    pFrame->ui32SizeY = pDevEnpInfo->ui32SizeY;
+    pFrame->ui64BlockID = ui64BlockID;
+    pFrame->ui64Timestamp = pDevEnpInfo->ui64Timestamp;
+    if (pFileName != NULL)
+    {
+        pFrame->bImage = true;
+        strcpy(pFrame->arrFileName, pFileName);
+    }
+    return pHeader->ui32FrameNum;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		在结果缓存中登记一个payload模块在log文件中的位置
+\parm   	pCache					结果缓存
+\parm   	ui32Frame				所属帧在帧表中的下标+1
+\parm   	ui64Offset				模块首行在log文件中的偏移
+\parm   	ui32LineNum				模块行数
+\parm   	ui64ValidSize			计入图像的字节数
+\return
+*/
+//-----------------------------------------------------------
+void CacheAddSpan(RESULT_CACHE *pCache, uint32_t ui32Frame, uint64_t ui64Offset, uint32_t ui32LineNum, uint64_t ui64ValidSize)
+{
+    CACHE_HEADER *pHeader = &pCache->stHeader;
+    if (pHeader->ui32SpanNum >= pCache->ui32SpanCapacity)
+    {
+        uint32_t ui32Capacity = (pCache->ui32SpanCapacity == 0) ? DEV_ENP_MAP_INIT_SIZE : pCache->ui32SpanCapacity * 2;
+        pCache->pSpan = (CACHE_SPAN *)GrowArray(pCache->pSpan, pHeader->ui32SpanNum, ui32Capacity, sizeof(CACHE_SPAN));
+        pCache->ui32SpanCapacity = ui32Capacity;
+    }
+
+    CACHE_SPAN *pSpan = &pCache->pSpan[pHeader->ui32SpanNum++];
+    pSpan->ui64Offset = ui64Offset;
+    pSpan->ui32FrameIndex = ui32Frame - 1;
+    pSpan->ui32LineNum = ui32LineNum;
+    pSpan->ui64ValidSize = ui64ValidSize;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		按大端序写入32位整数
+\parm   	pDst					目的地址
+\parm   	ui32Value				数值
+\return
+*/
+//-----------------------------------------------------------
+void PngPutUint32(uint8_t *pDst, uint32_t ui32Value)
+{
+    pDst[0] = (uint8_t)(ui32Value >> 24);
+    pDst[1] = (uint8_t)(ui32Value >> 16);
+    pDst[2] = (uint8_t)(ui32Value >> 8);
+    pDst[3] = (uint8_t)ui32Value;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		写入一个PNG块：长度、类型、数据、CRC
+\parm   	fpImage					图像文件
+\parm   	pType					4字节块类型
+\parm   	pData					块数据
+\parm   	ui32Length				块数据字节数
+\return
+*/
+//-----------------------------------------------------------
+void PngWriteChunk(FILE *fpImage, const char *pType, const uint8_t *pData, uint32_t ui32Length)
+{
+    uint8_t arrHead[8];
+    uint8_t arrCrc[4];
+    PngPutUint32(arrHead, ui32Length);
+    memcpy(arrHead + 4, pType, 4);
+    uLong ulCrc = crc32(0L, arrHead + 4, 4);
+    if (ui32Length > 0)     //crc32传入NULL时返回初值
+    {
+        ulCrc = crc32(ulCrc, pData, ui32Length);
+    }
+    PngPutUint32(arrCrc, (uint32_t)ulCrc);
+    fwrite(arrHead, 1, sizeof(arrHead), fpImage);
+    fwrite(pData, 1, ui32Length, fpImage);
+    fwrite(arrCrc, 1, sizeof(arrCrc), fpImage);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		将一帧payload编码为灰度PNG文件，逐行压缩，占用内存与帧大小无关
+\           payload不足一帧时只输出收到的行，最后一行不足部分补0；超出部分丢弃
+\parm   	pJob					编码任务
+\parm   	nLevel					zlib压缩级别
+\return		0 成功; -1 失败
+*/
+//-----------------------------------------------------------
+int PngWriteFile(const PNG_JOB *pJob, int nLevel)
+{
+    uint32_t ui32SampleSize = pJob->ui8BitDepth / 8;
+    uint64_t ui64RowSize = (uint64_t)pJob->ui32SizeX * ui32SampleSize;
+    if ((ui64RowSize == 0) || (pJob->ui32SizeY == 0) || (ui64RowSize >= UINT32_MAX))
+    {
+        printf("Png size error: %s\n", pJob->arrFileName);
+        return -1;
+    }
+    uint64_t ui64RowNum = (pJob->ui64Size + ui64RowSize - 1) / ui64RowSize;
+    ui64RowNum = (ui64RowNum < pJob->ui32SizeY) ? ui64RowNum : pJob->ui32SizeY;
+    ui64RowNum = (ui64RowNum == 0) ? 1 : ui64RowNum;
+
+    FILE *fpImage = fopen(pJob->arrFileName, "wb");
+    if (fpImage == NULL)
+    {
+        printf("Create image file fail!!!\n");
+        return -1;
+    }
+    const uint8_t arrSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    fwrite(arrSignature, 1, sizeof(arrSignature), fpImage);
+    uint8_t arrIhdr[13];
+    PngPutUint32(arrIhdr, pJob->ui32SizeX);
+    PngPutUint32(arrIhdr + 4, (uint32_t)ui64RowNum);
+    arrIhdr[8] = pJob->ui8BitDepth;
+    arrIhdr[9] = 0;     //灰度
+    arrIhdr[10] = 0;    //deflate
+    arrIhdr[11] = 0;    //自适应滤波，每行滤波类型为None
+    arrIhdr[12] = 0;    //不隔行
+    PngWriteChunk(fpImage, "IHDR", arrIhdr, sizeof(arrIhdr));
+
+    z_stream stStream;
+    memset(&stStream, 0, sizeof(z_stream));
+    if (deflateInit(&stStream, nLevel) != Z_OK)
+    {
+        fclose(fpImage);
+        return -1;
+    }
+    uint8_t *pRow = new uint8_t[ui64RowSize + 1];
+    uint8_t *pOut = new uint8_t[PNG_IDAT_SIZE];
+    stStream.next_out = pOut;
+    stStream.avail_out = PNG_IDAT_SIZE;
+    int nRet = 0;
+    for (uint64_t i = 0; (i < ui64RowNum) && (nRet == 0); ++i)
+    {
+        //每行前加滤波类型字节，16位像素由小端转为PNG要求的大端
+        uint64_t ui64Offset = i * ui64RowSize;
+        uint64_t ui64Copy = (pJob->ui64Size > ui64Offset) ? pJob->ui64Size - ui64Offset : 0;
+        ui64Copy = (ui64Copy < ui64RowSize) ? ui64Copy : ui64RowSize;
+        pRow[0] = 0;
+        memcpy(pRow + 1, pJob->pData + ui64Offset, ui64Copy);
+        memset(pRow + 1 + ui64Copy, 0, ui64RowSize - ui64Copy);
+        if (ui32SampleSize == 2)
+        {
+            for (uint64_t j = 1; j < ui64RowSize; j += 2)
+            {
+                uint8_t ui8Temp = pRow[j];
+                pRow[j] = pRow[j + 1];
+                pRow[j + 1] = ui8Temp;
+            }
+        }
+
+        stStream.next_in = pRow;
+        stStream.avail_in = (uInt)(ui64RowSize + 1);
+        int nFlush = (i + 1 == ui64RowNum) ? Z_FINISH : Z_NO_FLUSH;
+        int nZRet = Z_OK;
+        do
+        {
+            if (stStream.avail_out == 0)
+            {
+                PngWriteChunk(fpImage, "IDAT", pOut, PNG_IDAT_SIZE);
+                stStream.next_out = pOut;
+                stStream.avail_out = PNG_IDAT_SIZE;
+            }
+            nZRet = deflate(&stStream, nFlush);
+            if (nZRet == Z_STREAM_ERROR)
+            {
+                nRet = -1;
+                break;
+            }
+        } while ((stStream.avail_in > 0) || (stStream.avail_out == 0) || ((nFlush == Z_FINISH) && (nZRet != Z_STREAM_END)));
+    }
+    if ((nRet == 0) && (stStream.avail_out < PNG_IDAT_SIZE))
+    {
+        PngWriteChunk(fpImage, "IDAT", pOut, PNG_IDAT_SIZE - stStream.avail_out);
+    }
+    PngWriteChunk(fpImage, "IEND", NULL, 0);
+    deflateEnd(&stStream);
+    delete [] pRow;
+    delete [] pOut;
+
+    if (ferror(fpImage) != 0)
+    {
+        nRet = -1;
+    }
+    if (fclose(fpImage) != 0)
+    {
+        nRet = -1;
+    }
+    if (nRet != 0)
+    {
+        printf("Write png fail: %s\n", pJob->arrFileName);
+    }
+    return nRet;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		PNG编码线程：从队列取出任务编码写入，队列为空且已停止时退出
+\parm   	pUser					PNG编码线程池
+\return		NULL
+*/
+//-----------------------------------------------------------
+void *PngEncoderWorker(void *pUser)
+{
+    PNG_ENCODER *pEncoder = (PNG_ENCODER *)pUser;
+    while (true)
+    {
+        pthread_mutex_lock(&pEncoder->stMutex);
+        while ((pEncoder->ui32QueueNum == 0) && !pEncoder->bStop)
+        {
+            pthread_cond_wait(&pEncoder->stNotEmpty, &pEncoder->stMutex);
+        }
+        if (pEncoder->ui32QueueNum == 0)
+        {
+            pthread_mutex_unlock(&pEncoder->stMutex);
+            break;
+        }
+        PNG_JOB stJob = pEncoder->pQueue[pEncoder->ui32QueueHead];
+        pEncoder->ui32QueueHead = (pEncoder->ui32QueueHead + 1) % pEncoder->ui32QueueSize;
+        pEncoder->ui32QueueNum--;
+        pthread_cond_signal(&pEncoder->stNotFull);
+        pthread_mutex_unlock(&pEncoder->stMutex);
+
+        int nRet = PngWriteFile(&stJob, pEncoder->nLevel);
+        delete [] stJob.pData;
+
+        pthread_mutex_lock(&pEncoder->stMutex);
+        if (nRet == 0)
+        {
+            pEncoder->ui64EncodedNum++;
+        }
+        else
+        {
+            pEncoder->ui64FailNum++;
+        }
+        pthread_mutex_unlock(&pEncoder->stMutex);
+    }
+    return NULL;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		启动PNG编码线程池，线程数为在线CPU核数
+\parm   	pEncoder				PNG编码线程池
+\parm   	nLevel					zlib压缩级别
+\return		0 成功; -1 创建线程失败
+*/
+//-----------------------------------------------------------
+int PngEncoderInit(PNG_ENCODER *pEncoder, int nLevel)
+{
+    memset(pEncoder, 0, sizeof(PNG_ENCODER));
+    long lCpuNum = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t ui32ThreadNum = (lCpuNum > 0) ? (uint32_t)lCpuNum : 1;
+    pEncoder->nLevel = nLevel;
+    pEncoder->ui32QueueSize = ui32ThreadNum * PNG_QUEUE_PER_THREAD;
+    pEncoder->pQueue = new PNG_JOB[pEncoder->ui32QueueSize];
+    pEncoder->pThread = new pthread_t[ui32ThreadNum];
+    pthread_mutex_init(&pEncoder->stMutex, NULL);
+    pthread_cond_init(&pEncoder->stNotEmpty, NULL);
+    pthread_cond_init(&pEncoder->stNotFull, NULL);
+    for (uint32_t i = 0; i < ui32ThreadNum; ++i)
+    {
+        if (pthread_create(&pEncoder->pThread[pEncoder->ui32ThreadNum], NULL, PngEncoderWorker, pEncoder) == 0)
+        {
+            pEncoder->ui32ThreadNum++;
+        }
+    }
+    return (pEncoder->ui32ThreadNum == 0) ? -1 : 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		等待队列中的帧全部写完，停止并释放PNG编码线程池
+\parm   	pEncoder				PNG编码线程池
+\return
+*/
+//-----------------------------------------------------------
+void PngEncoderRelease(PNG_ENCODER *pEncoder)
+{
+    pthread_mutex_lock(&pEncoder->stMutex);
+    pEncoder->bStop = true;
+    pthread_cond_broadcast(&pEncoder->stNotEmpty);
+    pthread_mutex_unlock(&pEncoder->stMutex);
+    for (uint32_t i = 0; i < pEncoder->ui32ThreadNum; ++i)
+    {
+        pthread_join(pEncoder->pThread[i], NULL);
+    }
+
+    //线程创建失败时队列中可能残留任务
+    for (uint32_t i = 0; i < pEncoder->ui32QueueNum; ++i)
+    {
+        delete [] pEncoder->pQueue[(pEncoder->ui32QueueHead + i) % pEncoder->ui32QueueSize].pData;
+    }
+    pthread_mutex_destroy(&pEncoder->stMutex);
+    pthread_cond_destroy(&pEncoder->stNotEmpty);
+    pthread_cond_destroy(&pEncoder->stNotFull);
+    delete [] pEncoder->pQueue;
+    pEncoder->pQueue = NULL;
+    delete [] pEncoder->pThread;
+    pEncoder->pThread = NULL;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		将端口帧缓冲区中的完整帧交给PNG编码线程池，缓冲区随任务转交，端口下一帧重新分配
+\           队列满时等待，正在编码和排队的帧数不超过线程数加队列长度
+\parm   	pEncoder				PNG编码线程池
+\parm   	pDevEnpInfo				当前设备端口信息，帧缓冲区中为该帧payload
+\parm   	pFileName				图像文件路径
+\return
+*/
+//-----------------------------------------------------------
+void PngEncoderSubmit(PNG_ENCODER *pEncoder, DEV_ENP_INFO *pDevEnpInfo, const char *pFileName)
+{
+    PNG_JOB stJob;
+    memset(&stJob, 0, sizeof(PNG_JOB));
+    strcpy(stJob.arrFileName, pFileName);
+    stJob.pData = pDevEnpInfo->pFrameBuffer;
+    stJob.ui64Size = pDevEnpInfo->ui64FrameSize;
+    stJob.ui32SizeX = pDevEnpInfo->ui32SizeX;
+    stJob.ui32SizeY = pDevEnpInfo->ui32SizeY;
+    stJob.ui8BitDepth = (((pDevEnpInfo->ui32PixelFormat >> 16) & 0xFF) == 16) ? 16 : 8;  //PFNC像素格式16~23位为每像素占用位数
+    pDevEnpInfo->pFrameBuffer = NULL;
+    pDevEnpInfo->ui64FrameSize = 0;
+    pDevEnpInfo->ui64FrameBufferSize = 0;
+
+    pthread_mutex_lock(&pEncoder->stMutex);
+    while (pEncoder->ui32QueueNum == pEncoder->ui32QueueSize)
+    {
+        pthread_cond_wait(&pEncoder->stNotFull, &pEncoder->stMutex);
+    }
+    pEncoder->pQueue[(pEncoder->ui32QueueHead + pEncoder->ui32QueueNum) % pEncoder->ui32QueueSize] = stJob;
+    pEncoder->ui32QueueNum++;
+    pthread_cond_signal(&pEncoder->stNotEmpty);
+    pthread_mutex_unlock(&pEncoder->stMutex);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		处理payload模块：逐行转换数据段，累加payload指纹并写入图像文件，最后核对Length段
+\           模块首行已在pArrStr中，其余行从读取器逐行读取，占用内存与模块大小无关
+\parm   	pArrStr 				动态二维数组存储模块内容
+\parm   	nIndex					二维数组中有效数据行数
+\parm   	pContext				log解析上下文
+\parm   	pDevEnpStatus			当前设备端口状态
+\parm   	pDevEnpInfo				当前设备端口信息
+\return		计入该帧的payload字节数(Length段)
+*/
+//-----------------------------------------------------------
+uint64_t PayloadAnalysis(char **pArrStr, int nIndex, LOG_CONTEXT *pContext, DEV_ENP_STATUS *pDevEnpStatus, DEV_ENP_INFO *pDevEnpInfo)
+{
+    //计算当前payload size
+    const LOCATION_OFFSET &stOffset = pContext->stOffset;
+    uint32_t ui32PayloadSize = GetBlockLength(pArrStr[0], stOffset);
+    if (!pContext->bDecodePayload || pDevEnpStatus->bSkipPayload)
+    {
+        return ui32PayloadSize;
+    }
+    pContext->ui64SampledBytes += ui32PayloadSize;
+
+	//payload写入文件
+    FILE *fpImage = NULL;
+    bool bFrameBuffer = (pContext->nRawFd >= 0) || (pContext->bImageOutput && (pContext->pPngEncoder != NULL));
+    if (pContext->bImageOutput && (pContext->pPngEncoder == NULL))
+    {
+        fpImage = fopen(pDevEnpInfo->arrCurrentFileName, "a+");
+        if (fpImage == NULL)
+        {
+            printf("Open image file fail!!!\n");
+        }
+    }
+
+    char arrLine[ROW_LENGTH];
+    char arrPayload[ROW_LENGTH];
+    const char *pLine = pArrStr[0];
+    uint64_t ui64DecodeSize = 0;
+    uint64_t ui64WriteSize = 0;
+    bool bWrongNum = false;
+    int i = 1;
+    for (; pLine != NULL; ++i)
+    {
+        bool bLineWrongNum = false;
+        int nByte = GetLineBytes(pLine, stOffset, arrPayload, ROW_LENGTH, bLineWrongNum);
+        if (bLineWrongNum)
+        {
+            printf("Wrong Num!\n");
+            bWrongNum = true;
+        }
+        //超出Length段的数据不计入图像
+        uint64_t ui64ValidSize = (ui64DecodeSize >= ui32PayloadSize) ? 0 : ui32PayloadSize - ui64DecodeSize;
+        ui64ValidSize = (nByte < (int)ui64ValidSize) ? nByte : ui64ValidSize;
+        ui64DecodeSize += nByte;
+        if (pContext->pfnRecordSink != NULL)
+        {
+            pDevEnpStatus->ui64PayloadHash = HashBytes(pDevEnpStatus->ui64PayloadHash, arrPayload, ui64ValidSize);
+        }
+        if (fpImage != NULL)
+        {
+            ui64WriteSize += fwrite(arrPayload, 1, ui64ValidSize, fpImage);
+        }
+        if (bFrameBuffer)
+        {
+            FrameBufferAppend(pDevEnpInfo, arrPayload, ui64ValidSize);
+        }
+
+        if (i < nIndex)
+        {
+            pLine = pArrStr[i];
+        }
+        else
+        {
+            pLine = (LogReaderNextLine(pContext->pReader, stOffset, arrLine) == 0) ? arrLine : NULL;
+        }
+    }
+    if ((pContext->pCache != NULL) && (pDevEnpInfo->ui32CacheFrame != 0))
+    {
+        CacheAddSpan(pContext->pCache, pDevEnpInfo->ui32CacheFrame, pContext->pReader->ui64BlockOffset, i - 1
+                   , (ui64DecodeSize < ui32PayloadSize) ? ui64DecodeSize : ui32PayloadSize);
+    }
+
+    if (fpImage != NULL)
+    {
+        printf("ActualWriteByte = %llu\n", (unsigned long long)ui64WriteSize);
+        fclose(fpImage);
+        fpImage = NULL;
+    }
+    if (bWrongNum)
+    {
+        pDevEnpInfo->arrErrCount[STREAM_ERR_BAD_HEX]++;
+    }
+    else if (ui64DecodeSize != ui32PayloadSize)   //非法字符导致的字节数不符已计为STREAM_ERR_BAD_HEX
+    {
+        pDevEnpInfo->arrErrCount[STREAM_ERR_BLOCK_LENGTH]++;
+        if (pContext->bErrorOutput)
+        {
+            char arrName[DEV_ENP_NAME_SIZE];
+            FileSprintf(pContext->pArrResultFileName, "%s(%s)\n", g_arrStreamErrorMsg[STREAM_ERR_BLOCK_LENGTH], DevEnpName(pDevEnpInfo->stDevEnpNum, true, arrName));
+        }
+    }
+    return ui32PayloadSize;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		查找事件ID对应的延时统计项，不存在则新建
+\parm   	pTimeline				设备事件时间线
+\parm   	ui16EventID				事件ID
+\return		统计项指针，种类超过EVENT_ID_STAT_NUM时返回NULL
+*/
+//-----------------------------------------------------------
+EVENT_LATENCY_STAT *GetEventStat(EVENT_TIMELINE *pTimeline, uint16_t ui16EventID)
+{
+    for (int i = 0; i < pTimeline->ui16StatNum; ++i)
+    {
+        if (pTimeline->arrStat[i].ui16EventID == ui16EventID)
+        {
+            return &pTimeline->arrStat[i];
+        }
+    }
+    if (pTimeline->ui16StatNum >= EVENT_ID_STAT_NUM)
+    {
+        return NULL;
+    }
+    EVENT_LATENCY_STAT *pStat = &pTimeline->arrStat[pTimeline->ui16StatNum++];
+    memset(pStat, 0, sizeof(EVENT_LATENCY_STAT));
+    pStat->ui16EventID = ui16EventID;
+    pStat->ui64LatencyMin = UINT64_MAX;
+    return pStat;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		将事件加入设备时间线，缓冲区满时覆盖最早的未关联事件
+\parm   	pTimeline				设备事件时间线
+\parm   	pEventCmd				解码后的事件包
+\return
+*/
+//-----------------------------------------------------------
+void EventTimelinePush(EVENT_TIMELINE *pTimeline, const EVENT_CMD *pEventCmd)
+{
+    if (pTimeline->pRing == NULL)
+    {
+        pTimeline->pRing = new EVENT_ENTRY[EVENT_RING_SIZE];
+    }
+    if (pTimeline->ui64Head - pTimeline->ui64Matched >= EVENT_RING_SIZE)
+    {
+        pTimeline->ui64Matched++;
+        pTimeline->ui64Dropped++;
+    }
+
+    EVENT_ENTRY *pEntry = &pTimeline->pRing[pTimeline->ui64Head & (EVENT_RING_SIZE - 1)];
+    pEntry->ui64Timestamp = pEventCmd->m_stSCDEventCmd.ui32TimeStamp;
+    pEntry->ui16EventID = pEventCmd->m_stSCDEventCmd.ui16EventID;
+    pEntry->ui16DataLength = 0;
+    pEntry->ui32Data = 0;
+    if (pEventCmd->m_stCCDCmd.ui16Length > EVENT_SCD_HEAD_LENGTH)
+    {
+        pEntry->ui16DataLength = pEventCmd->m_stCCDCmd.ui16Length - EVENT_SCD_HEAD_LENGTH;
+        memcpy(&pEntry->ui32Data, pEventCmd->m_stSCDEventCmd.arrData, pEntry->ui16DataLength < sizeof(uint32_t) ? pEntry->ui16DataLength : sizeof(uint32_t));
+    }
+    pTimeline->ui64Head++;
+
+    EVENT_LATENCY_STAT *pStat = GetEventStat(pTimeline, pEntry->ui16EventID);
+    if (pStat != NULL)
+    {
+        pStat->ui64EventCount++;
+    }
+}
+
+//-----------------------------------------------------------
+/*
+\brief		收到ImageLeader时，将时间戳不晚于Leader的未关联事件与该帧关联，统计事件到帧的延时
+\parm   	pTimeline				设备事件时间线
+\parm   	ui64LeaderTimestamp		ImageLeader中的时间戳
+\return
+*/
+//-----------------------------------------------------------
+void EventTimelineOnLeader(EVENT_TIMELINE *pTimeline, uint64_t ui64LeaderTimestamp)
+{
+    pTimeline->ui64LeaderCount++;
+    while (pTimeline->ui64Matched < pTimeline->ui64Head)
+    {
+        EVENT_ENTRY *pEntry = &pTimeline->pRing[pTimeline->ui64Matched & (EVENT_RING_SIZE - 1)];
+        if (pEntry->ui64Timestamp > ui64LeaderTimestamp)    //事件属于后续的帧
+        {
+            break;
+        }
+        EVENT_LATENCY_STAT *pStat = GetEventStat(pTimeline, pEntry->ui16EventID);
+        if (pStat != NULL)
+        {
+            uint64_t ui64Latency = ui64LeaderTimestamp - pEntry->ui64Timestamp;
+            pStat->ui64MatchCount++;
+            pStat->ui64LatencySum += ui64Latency;
+            pStat->ui64LatencyMin = (ui64Latency < pStat->ui64LatencyMin) ? ui64Latency : pStat->ui64LatencyMin;
+            pStat->ui64LatencyMax = (ui64Latency > pStat->ui64LatencyMax) ? ui64Latency : pStat->ui64LatencyMax;
+        }
+        pTimeline->ui64Matched++;
+    }
+}
+
+//-----------------------------------------------------------
+/*
+\brief		输出各设备事件统计及事件到帧的延时
+\parm   	pDeviceTable			设备状态表
+\parm   	pArrResultFileName		解析结果文件路径
+\return
+*/
+//-----------------------------------------------------------
+void EventTimelineReport(const DEVICE_TABLE *pDeviceTable, char *pArrResultFileName)
+{
+    char arrName[DEV_ENP_NAME_SIZE];
+    for (uint32_t i = 0; i < pDeviceTable->ui32Num; ++i)
+    {
+        const EVENT_TIMELINE *pTimeline = &pDeviceTable->pDevice[i].stEventTimeline;
+        if (pTimeline->pRing == NULL)
+        {
+            continue;
+        }
+        FileSprintf(pArrResultFileName, "#EventTimeline(%s): Events:%llu Leaders:%llu Dropped:%llu\n", DevEnpName(pDeviceTable->pDevice[i].stDevEnpNum, false, arrName)
+                                                                                                    , pTimeline->ui64Head
+                                                                                                    , pTimeline->ui64LeaderCount
+                                                                                                    , pTimeline->ui64Dropped);
+        for (int j = 0; j < pTimeline->ui16StatNum; ++j)
+        {
+            const EVENT_LATENCY_STAT *pStat = &pTimeline->arrStat[j];
+            FileSprintf(pArrResultFileName, "    EventID:0x%x Count:%llu Matched:%llu", pStat->ui16EventID
+                                                                                      , pStat->ui64EventCount
+                                                                                      , pStat->ui64MatchCount);
+            if (pStat->ui64MatchCount != 0)
+            {
+                FileSprintf(pArrResultFileName, " Trigger-to-Frame Latency(min/avg/max):%llu/%llu/%llu ticks", pStat->ui64LatencyMin
+                                                                                                            , pStat->ui64LatencySum / pStat->ui64MatchCount
+                                                                                                            , pStat->ui64LatencyMax);
+            }
+            FileSprintf(pArrResultFileName, "\n");
+        }
+        FileSprintf(pArrResultFileName, "\n");
+    }
+}
+
+//-----------------------------------------------------------
+/*
+\brief		由读写命令、应答和事件包生成控制事务记录，ACK通过RequestID关联到命令的寄存器地址
+\parm   	pCmdPacket				转换后的命令包
+\parm   	nPacketSize				命令包缓冲区字节数
+\parm   	pContext				log解析上下文
+\parm   	stDevEnpNum				当前模块设备号和端口号
+\parm   	pBlockLine				当前模块首行，用于获取时间和Length
+\return
+*/
+//-----------------------------------------------------------
+void CommandToRecord(const char *pCmdPacket, int nPacketSize, LOG_CONTEXT *pContext, const DEV_ENP_NUM &stDevEnpNum, const char *pBlockLine)
+{
+    const READ_MEM_CMD *pCMD = (const READ_MEM_CMD *)pCmdPacket;
+    DEVICE_STATUS *pDeviceInfo = DeviceTableGet(&pContext->stDeviceTable, stDevEnpNum);
+    PENDING_CMD *pArrPendingCmd = pDeviceInfo->arrPendingCmd;
+    U3V_RECORD stRecord;
+    memset(&stRecord, 0, sizeof(U3V_RECORD));
+    stRecord.ui8Type = RECORD_CONTROL;
+    stRecord.stDevEnpNum = stDevEnpNum;
+    stRecord.ui32DeviceIndex = (uint32_t)(pDeviceInfo - pContext->stDeviceTable.pDevice);
+    stRecord.ui16CommandID = pCMD->m_stCCDCmd.ui16CommandID;
+    stRecord.ui64Hash = FNV_OFFSET_BASIS;
+    stRecord.ui64BlockNum = pContext->ui64BlockNum;
+    stRecord.ui64Time = GetBlockTime(pBlockLine, pContext->stOffset);
+    stRecord.ui64WireLength = GetBlockLength(pBlockLine, pContext->stOffset);
+
+    //SCD数据不能超出已转换的缓冲区
+    int nScdMax = nPacketSize - (int)(sizeof(PREFIX) + sizeof(CCD_CMD));
+    int nScdLength = (pCMD->m_stCCDCmd.ui16Length < nScdMax) ? pCMD->m_stCCDCmd.ui16Length : nScdMax;
+    const uint8_t *pScd = (const uint8_t *)pCmdPacket + sizeof(PREFIX) + sizeof(CCD_CMD);
+
+    if (pCMD->m_stPrefix.ui32Prefix == U3V_PREFIX_EVENT_PACKET)
+    {
+        if (pCMD->m_stCCDCmd.ui16CommandID != U3V_EVENT_CMD)
+        {
+            return;
+        }
+        const EVENT_CMD *pstEventCMD = (const EVENT_CMD *)pCmdPacket;
+        stRecord.ui64Key = pstEventCMD->m_stSCDEventCmd.ui16EventID;
+        if (nScdLength > EVENT_SCD_HEAD_LENGTH)
+        {
+            stRecord.ui64Length = nScdLength - EVENT_SCD_HEAD_LENGTH;
+            stRecord.ui64Hash = HashBytes(stRecord.ui64Hash, pstEventCMD->m_stSCDEventCmd.arrData, stRecord.ui64Length);
+        }
+    }
+    else if (pCMD->m_stPrefix.ui32Prefix != U3V_PREFIX_COMMAND_PACKET)
+    {
+        return;
+    }
+    else if ((pCMD->m_stCCDCmd.ui16CommandID == U3V_READ_MEM_CMD) || (pCMD->m_stCCDCmd.ui16CommandID == U3V_WRITE_MEM_CMD))
+    {
+        stRecord.ui64Key = pCMD->m_stSCDReadMemCmd.ui64RegisterAddress;
+        if (pCMD->m_stCCDCmd.ui16CommandID == U3V_READ_MEM_CMD)
+        {
+            stRecord.ui64Length = pCMD->m_stSCDReadMemCmd.ui16ReadLength;
+        }
+        else if (nScdLength > (int)sizeof(uint64_t))
+        {
+            stRecord.ui64Length = nScdLength - sizeof(uint64_t);
+            stRecord.ui64Hash = HashBytes(stRecord.ui64Hash, pScd + sizeof(uint64_t), stRecord.ui64Length);
+            memcpy(&stRecord.ui64Value, pScd + sizeof(uint64_t), (stRecord.ui64Length < sizeof(uint64_t)) ? stRecord.ui64Length : sizeof(uint64_t));
+        }
+
+        PENDING_CMD *pPending = &pArrPendingCmd[pCMD->m_stCCDCmd.ui16RequestID & (PENDING_CMD_NUM - 1)];
+        pPending->bValid = true;
+        pPending->ui16RequestID = pCMD->m_stCCDCmd.ui16RequestID;
+        pPending->ui16CommandID = pCMD->m_stCCDCmd.ui16CommandID;
+        pPending->ui64Address = stRecord.ui64Key;
+    }
+    else if ((pCMD->m_stCCDCmd.ui16CommandID == U3V_READ_MEM_ACK) || (pCMD->m_stCCDCmd.ui16CommandID == U3V_WRITE_MEM_ACK))
+    {
+        const CCD_ACK *pCCDAck = (const CCD_ACK *)(pCmdPacket + sizeof(PREFIX));
+        stRecord.ui16Status = pCCDAck->ui16StatusCode;
+        stRecord.ui64Key = UINT64_MAX;  //找不到对应命令时地址未知
+        PENDING_CMD *pPending = &pArrPendingCmd[pCCDAck->ui16RequestID & (PENDING_CMD_NUM - 1)];
+        if (pPending->bValid && (pPending->ui16RequestID == pCCDAck->ui16RequestID) && (pPending->ui16CommandID + 1 == pCCDAck->ui16CommandID))
+        {
+            stRecord.ui64Key = pPending->ui64Address;
+            pPending->bValid = false;
+        }
+
+        if (pCCDAck->ui16CommandID == U3V_READ_MEM_ACK)
+        {
+            stRecord.ui64Length = nScdLength;
+            stRecord.ui64Hash = HashBytes(stRecord.ui64Hash, pScd, nScdLength);
+            memcpy(&stRecord.ui64Value, pScd, (nScdLength < (int)sizeof(uint64_t)) ? nScdLength : sizeof(uint64_t));
+        }
+        else
+        {
+            stRecord.ui64Length = ((const WRITE_MEM_ACK *)pCmdPacket)->m_stSCDWriteMemAck.nWriteLength;
+        }
+    }
+    else
+    {
+        return;     //Pending等其它应答不生成记录
+    }
+
+    pContext->pfnRecordSink(pContext->pSinkUser, stRecord);
+}
+
+//-----------------------------------------------------------
+/*
+\brief  单模块解析
+\parm   arrStr[][ROW_LENGTH]        单独一个模块的数据
+\parm   index                       模块的行数
+\parm   stOffset                      各数据段偏移量结构体
+\parm   stDevEnpNum                 当前模块设备号和端口号
+\parm   pContext                    log解析上下文
+\return
+*/
+//-----------------------------------------------------------
+int CodeToCMD(char **pArrStr, int nIndex, LOG_CONTEXT *pContext, const DEV_ENP_NUM &stDevEnpNum)
+{
+    uint64_t ui64Temp = 0;
+    uint16_t ui16Temp = 0;
+    uint64_t ui64ADDR = 0;
+    uint16_t ui16CMDID = 0;
+    char arrDescript[DESCRIPTION_LENGTH];
+    char arrName[DEV_ENP_NAME_SIZE];
+    char *pArrResultFileName = pContext->pArrResultFileName;
+    char *pCmdPacket = new char[nIndex*ROW_LENGTH];
+    
+    GetPacket(pArrStr, nIndex, pContext->stOffset, pCmdPacket);
+    READ_MEM_CMD *pCMD = (READ_MEM_CMD *)pCmdPacket;
+
+    if ((pCMD->m_stPrefix.ui32Prefix == U3V_PREFIX_EVENT_PACKET) && (pCMD->m_stCCDCmd.ui16CommandID == U3V_EVENT_CMD))
+    {
+        EventTimelinePush(&DeviceTableGet(&pContext->stDeviceTable, stDevEnpNum)->stEventTimeline, (EVENT_CMD *)pCmdPacket);
+    }
+    if (pContext->pfnRecordSink != NULL)
+    {
+        CommandToRecord(pCmdPacket, nIndex*ROW_LENGTH, pContext, stDevEnpNum, pArrStr[0]);
+    }
+    if (!pContext->bTextOutput)
+    {
+        delete [] pCmdPacket;
+        return 0;
+    }
+
+    if (pCMD->m_stPrefix.ui32Prefix == U3V_PREFIX_COMMAND_PACKET) //判断是否为U3VC
+    {
+        if (pCMD->m_stCCDCmd.ui16CommandID == U3V_READ_MEM_CMD)   
+        {   
+            READ_MEM_CMD *pstReadMemCMD = (READ_MEM_CMD *)pCmdPacket;
+            FileSprintf(pArrResultFileName, "#READ CMD:  PREFIX:0x%x Flags:0x%x CommandID:0x%x RequestID:0x%x Address:0x%llx ReadLength:0x%x\n\n", pstReadMemCMD->m_stPrefix.ui32Prefix
+                                                                                                   , pstReadMemCMD->m_stCCDCmd.ui16Flag                 
+                                                                                                   , pstReadMemCMD->m_stCCDCmd.ui16CommandID
+                                                                                                   , pstReadMemCMD->m_stCCDCmd.ui16RequestID
+                                                                                                   , pstReadMemCMD->m_stSCDReadMemCmd.ui64RegisterAddress
+                                                                                                   , pstReadMemCMD->m_stSCDReadMemCmd.ui16ReadLength);
+        }
+        else if (pCMD->m_stCCDCmd.ui16CommandID == U3V_READ_MEM_ACK)  //RACK
+        {
+            READ_MEM_ACK *pstReadMemACK = (READ_MEM_ACK *)pCmdPacket;
+            FileSprintf(pArrResultFileName, "#READ ACK:  PREFIX:0x%x Status:0x%x CommandID:0x%x RequestID:0x%x SCDLength:0x%x SCDData:", pstReadMemACK->m_stPrefix.ui32Prefix
+                                                                                                    , pstReadMemACK->m_stCCDAck.ui16StatusCode
+                                                                                                    , pstReadMemACK->m_stCCDAck.ui16CommandID
+                                                                                                    , pstReadMemACK->m_stCCDAck.ui16RequestID
+                                                                                                    , pstReadMemACK->m_stCCDAck.ui16Length);
+            uint64_t *pui64Temp = NULL;
+            if (pstReadMemACK->m_stCCDAck.ui16Length == 8)
+            {
+                pui64Temp = (uint64_t *)pstReadMemACK->m_stSCDReadMemAck.arrData;
+                FileSprintf(pArrResultFileName, "0x%llx 0x%llx", (*pui64Temp) >> 32, (*pui64Temp) & 0x0000ffff);
+            }
+            else if (pstReadMemACK->m_stCCDAck.ui16Length == 4)
+            {
+                pui64Temp = (uint64_t *)pstReadMemACK->m_stSCDReadMemAck.arrData;
+                FileSprintf(pArrResultFileName, "0x%llx", (*pui64Temp) & 0x0000ffff);
+            }
+            else
+            {
+                FileSprintf(pArrResultFileName, "0x");
+                for (int i = 0; i < pstReadMemACK->m_stCCDAck.ui16Length; ++i)
+                {
+                    FileSprintf(pArrResultFileName, "%02x", pstReadMemACK->m_stSCDReadMemAck.arrData[i]);
+                    if (i >= READ_ACK_DATA_MAX)
+                    {
+                        FileSprintf(pArrResultFileName, "......");
+                        break;
+                    }
+                }
+
+            }
+            
+            FileSprintf(pArrResultFileName, "\n\n");
+        }
+        else if (pCMD->m_stCCDCmd.ui16CommandID == U3V_WRITE_MEM_CMD)
+        {
+            WRITE_MEM_CMD *pstWriteMemCMD = (WRITE_MEM_CMD *)pCmdPacket;
+            FileSprintf(pArrResultFileName, "#WRITE CMD:  PREFIX:0x%x Flags:0x%x CommandID:0x%x RequestID:0x%x Address:0x%llx", pstWriteMemCMD->m_stPrefix.ui32Prefix
+                                                                                                   , pstWriteMemCMD->m_stCCDCmd.ui16Flag
+                                                                                                   , pstWriteMemCMD->m_stCCDCmd.ui16CommandID
+                                                                                                   , pstWriteMemCMD->m_stCCDCmd.ui16RequestID
+                                                                                                   , pstWriteMemCMD->m_stSCDWriteMemCmd.ui64RegisterAddress);
+            FileSprintf(pArrResultFileName, " SCDData:");
+            uint64_t *pui64Temp = NULL;
+            if (pstWriteMemCMD->m_stCCDCmd.ui16Length - 8 == 8)
+            {
+                pui64Temp = (uint64_t *)(pstWriteMemCMD->m_stSCDWriteMemCmd.arrData + 8);
+                FileSprintf(pArrResultFileName, "0x%llx 0x%llx", (*pui64Temp) >> 32, (*pui64Temp) & 0x0000ffff);
+            }
+            else if (pstWriteMemCMD->m_stCCDCmd.ui16Length - 8 == 4)
+            {
+                pui64Temp = (uint64_t *)(pstWriteMemCMD->m_stSCDWriteMemCmd.arrData + 8);
+                FileSprintf(pArrResultFileName, "0x%llx", (*pui64Temp) & 0x0000ffff);
+            }
+            else
+            {
+                FileSprintf(pArrResultFileName, "0x");
+                for (int i = 0; i < pstWriteMemCMD->m_stCCDCmd.ui16Length - 8; ++i)
+                {
+                    FileSprintf(pArrResultFileName, "%02x", pstWriteMemCMD->m_stSCDWriteMemCmd.arrData[i]);
                     if (i >= READ_ACK_DATA_MAX)
                     {
-                        FileSprintf(pArrResultFileName, "......");
-                        break;
+                        FileSprintf(pArrResultFileName, "......");
+                        break;
+                    }
+                }
+            }
+            FileSprintf(pArrResultFileName, "\n\n");
+        }
+        else if (pCMD->m_stCCDCmd.ui16CommandID == U3V_WRITE_MEM_ACK)
+        {
+            WRITE_MEM_ACK *pstWriteMemACK = (WRITE_MEM_ACK *)pCmdPacket;
+            FileSprintf(pArrResultFileName, "#WRITE ACK:  PREFIX:0x%x Status:0x%x CommandID:0x%x RequestID:0x%x SCDLength:0x%x nWriteLength:0x%x\n", pstWriteMemACK->m_stPrefix.ui32Prefix
+                                                                                                   , pstWriteMemACK->m_stCCDAck.ui16StatusCode
+                                                                                                   , pstWriteMemACK->m_stCCDAck.ui16CommandID
+                                                                                                   , pstWriteMemACK->m_stCCDAck.ui16RequestID
+                                                                                                   , pstWriteMemACK->m_stCCDAck.ui16Length
+                                                                                                   , pstWriteMemACK->m_stSCDWriteMemAck.nWriteLength);
+            FileSprintf(pArrResultFileName, "\n");
+        }
+
+    }
+    else if (pCMD->m_stPrefix.ui32Prefix == U3V_PREFIX_EVENT_PACKET) //判断是否为U3VE
+    {
+        EVENT_CMD *pstEventCMD = (EVENT_CMD *)pCmdPacket;
+        if (pstEventCMD->m_stCCDCmd.ui16CommandID == U3V_EVENT_CMD)
+        {
+            FileSprintf(pArrResultFileName, "#EVENT CMD(%s):  PREFIX:0x%x Flags:0x%x CommandID:0x%x RequestID:0x%x EventID:0x%x Timestamp:0x%llx EventData:0x"
+                                                                                                   , DevEnpName(stDevEnpNum, true, arrName)
+                                                                                                   , pstEventCMD->m_stPrefix.ui32Prefix
+                                                                                                   , pstEventCMD->m_stCCDCmd.ui16Flag
+                                                                                                   , pstEventCMD->m_stCCDCmd.ui16CommandID
+                                                                                                   , pstEventCMD->m_stCCDCmd.ui16RequestID
+                                                                                                   , pstEventCMD->m_stSCDEventCmd.ui16EventID
+                                                                                                   , pstEventCMD->m_stSCDEventCmd.ui32TimeStamp);
+            for (int i = 0; i < pstEventCMD->m_stCCDCmd.ui16Length - EVENT_SCD_HEAD_LENGTH; ++i)
+            {
+                FileSprintf(pArrResultFileName, "%02x", pstEventCMD->m_stSCDEventCmd.arrData[i]);
+                if (i >= READ_ACK_DATA_MAX)
+                {
+                    FileSprintf(pArrResultFileName, "......");
+                    break;
+                }
+            }
+            FileSprintf(pArrResultFileName, "\n\n");
+        }
+    }
+   
+    delete [] pCmdPacket;
+    pCmdPacket = NULL;
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		收到Leader时判断该帧是否抽样解析，未抽样的帧不转换payload、不输出图像
+\parm   	pContext				log解析上下文
+\parm   	pDevEnpInfo				当前设备端口信息，ui64FrameCount已包含该帧
+\return		true 解析该帧
+*/
+//-----------------------------------------------------------
+bool FrameSampled(LOG_CONTEXT *pContext, DEV_ENP_INFO *pDevEnpInfo)
+{
+    if ((pContext->ui32EveryNthFrame > 1) && ((pDevEnpInfo->ui64FrameCount - 1) % pContext->ui32EveryNthFrame != 0))
+    {
+        return false;
+    }
+    if ((pContext->ui32FramesPerStream != 0) && (pDevEnpInfo->ui64SampledCount >= pContext->ui32FramesPerStream))
+    {
+        return false;
+    }
+    if ((pContext->ui64MaxBytes != 0) && (pContext->ui64SampledBytes >= pContext->ui64MaxBytes))
+    {
+        return false;
+    }
+    pDevEnpInfo->ui64SampledCount++;
+    pContext->ui64SampledFrames++;
+    return true;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		记录流错误，并将设备端口状态复位为等待Leader，从下一个U3V前缀重新同步
+\parm   	pDevEnpStatus			设备端口状态
+\parm   	pDevEnpInfo				设备端口信息
+\parm   	eError					错误类型
+\parm   	stDevEnpNum				当前模块设备号和端口号
+\parm   	pBlockLine				当前模块首行，不输出解析文本时用于定位错误
+\parm   	pContext				log解析上下文
+\return
+*/
+//-----------------------------------------------------------
+void StreamResync(DEV_ENP_STATUS *pDevEnpStatus, DEV_ENP_INFO *pDevEnpInfo, STREAM_ERROR eError, const DEV_ENP_NUM &stDevEnpNum, char *pBlockLine, LOG_CONTEXT *pContext)
+{
+    pDevEnpInfo->arrErrCount[eError]++;
+    pDevEnpStatus->ui8Status = 0;
+    pDevEnpStatus->ui64PayloadSizeSum = 0;
+
+    if (!pContext->bErrorOutput)
+    {
+        return;
+    }
+    char arrName[DEV_ENP_NAME_SIZE];
+    FileSprintf(pContext->pArrResultFileName, "%s(%s)\n", g_arrStreamErrorMsg[eError], DevEnpName(stDevEnpNum, true, arrName));
+    if (!pContext->bTextOutput)
+    {
+        printf("    %s", pBlockLine);
+        if (g_fpTextCache != NULL)
+        {
+            fprintf(g_fpTextCache, "    %s", pBlockLine);
+        }
+    }
+}
+
+//-----------------------------------------------------------
+/*
+\brief		结合端口状态判断模块类型
+\           空闲端口上U3V前缀即为协议包；正在接收payload的流端口上不会出现命令包和事件包，
+\           Leader和Trailor还要求大小字段与Length段相同，否则是恰好以U3V前缀开头的payload数据
+\parm   	pContext				log解析上下文，stBlockHead为当前模块首行开头
+\parm   	pDevEnpStatus			当前设备端口状态
+\parm   	pLine					模块首行
+\return		协议包前缀; 0 payload或其它数据
+*/
+//-----------------------------------------------------------
+uint32_t BlockPrefix(const LOG_CONTEXT *pContext, const DEV_ENP_STATUS *pDevEnpStatus, const char *pLine)
+{
+    const BLOCK_HEAD &stHead = pContext->stBlockHead;
+    uint32_t ui32Prefix = stHead.stPrefix.ui32Prefix;
+    if (!IsU3VPrefix(ui32Prefix))
+    {
+        return 0;
+    }
+    if (pDevEnpStatus->ui8Status == 0)
+    {
+        return ui32Prefix;
+    }
+    //ui16LeaderSize、ui16TrailerSize与CCD的ui16CommandID位置相同
+    if (((ui32Prefix == U3V_PREFIX_IMAGE_LEADER) || (ui32Prefix == U3V_PREFIX_IMAGE_TRAILER))
+     && (stHead.stCCD.ui16CommandID == GetBlockLength(pLine, pContext->stOffset)))
+    {
+        return ui32Prefix;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief  单模块解析
+\parm   pArrStr[][ROW_LENGTH]        单独一个模块的数据
+\parm   index                       模块的行数
+\parm   pContext                    log解析上下文
+\return 0 正常; -1 模块存在协议错误(对应设备端口已复位并记录错误)
+*/
+//-----------------------------------------------------------
+int ModuleAnalysis(char **pArrStr, int nIndex, LOG_CONTEXT *pContext)
+{
+    const LOCATION_OFFSET &stOffset = pContext->stOffset;
+    char *pArrResultFileName = pContext->pArrResultFileName;
+    char arrFileName[FILENAME_SIZE];
+    char arrName[DEV_ENP_NAME_SIZE];
+    DEV_ENP_NUM stDevEnpNum = {0, 0, 0};
+    int nRet = GetDevEnpNum(pArrStr[0], stDevEnpNum);
+    if (nRet != 0)
+    {
+        if (pContext->bTextOutput)
+        {
+            FileSprintf(pArrResultFileName, "%s", pArrStr[0]);
+        }
+        printf("Error GetDevEnpNum\n");
+        return -1;
+    }
+    uint32_t ui32DevEnpIndex = DevEnpTableGet(&pContext->stDevEnpTable, stDevEnpNum);
+    DEV_ENP_STATUS *pDevEnpStatus = &pContext->stDevEnpTable.pHot[ui32DevEnpIndex];
+    DEV_ENP_INFO *pDevEnpInfo = &pContext->stDevEnpTable.pCold[ui32DevEnpIndex];
+
+    char arrPhase[20];
+    memcpy(arrPhase, pArrStr[0] + stOffset.ui16PhaseOff, stOffset.ui16PhaseLength);
+    arrPhase[stOffset.ui16PhaseLength] = '\0';
+
+    //模块类型由读取器转换的首行前缀和端口状态决定，模块其余数据按需转换；ui32Prefix为0表示payload数据
+    uint32_t ui32Prefix = BlockPrefix(pContext, pDevEnpStatus, pArrStr[0]);
+    //协议包模块不完整无法解析，跳过该模块并复位端口
+    bool bOversize = (ui32Prefix != 0) && (pContext->pReader != NULL) && pContext->pReader->bOversize;
+    if (pContext->bTextOutput)
+    {
+        //协议包输出整个模块，payload和跳过的模块只输出首行
+        int nEchoNum = ((ui32Prefix != 0) && !bOversize) ? nIndex : 1;
+        for (int i = 0; i < nEchoNum; ++i)
+        {
+            FileSprintf(pArrResultFileName, "%s", pArrStr[i]);
+        }
+    }
+    if (bOversize)
+    {
+        StreamResync(pDevEnpStatus, pDevEnpInfo, STREAM_ERR_BLOCK_OVERSIZE, stDevEnpNum, pArrStr[0], pContext);
+        return -1;
+    }
+
+    //帧未结束时出现新的U3V前缀，复位该端口；若该模块是新的Leader则从它重新开始
+    if (ui32Prefix != 0)
+    {
+        if (pDevEnpStatus->ui8Status == 1)
+        {
+            StreamResync(pDevEnpStatus, pDevEnpInfo, STREAM_ERR_NO_PAYLOAD, stDevEnpNum, pArrStr[0], pContext);
+            nRet = -1;
+        }
+        else if ((pDevEnpStatus->ui8Status == 2) && (ui32Prefix != U3V_PREFIX_IMAGE_TRAILER))
+        {
+            StreamResync(pDevEnpStatus, pDevEnpInfo, STREAM_ERR_NO_TRAILER, stDevEnpNum, pArrStr[0], pContext);
+            nRet = -1;
+        }
+        if ((nRet != 0) && (ui32Prefix != U3V_PREFIX_IMAGE_LEADER))
+        {
+            return -1;
+        }
+    }
+
+    if (pDevEnpStatus->ui8Status == 0)  //U3VC
+    {
+        if ((ui32Prefix == U3V_PREFIX_COMMAND_PACKET) || (ui32Prefix == U3V_PREFIX_EVENT_PACKET))  //U3VC命令包或U3VE事件包
+        {
+            if (pContext->bTextOutput || (pContext->pfnRecordSink != NULL))
+            {
+                CodeToCMD(pArrStr, nIndex, pContext, stDevEnpNum);
+            }
+        }
+        else if (ui32Prefix == U3V_PREFIX_IMAGE_LEADER)
+        {
+            //打印Leader信息
+            char *pCmdPacket = new char[nIndex*ROW_LENGTH];
+            if (GetPacket(pArrStr, nIndex, stOffset, pCmdPacket) < 0)
+            {
+                pDevEnpInfo->arrErrCount[STREAM_ERR_BAD_HEX]++;
+            }
+            IMAGE_LEADER *pImageLeader = (IMAGE_LEADER *)pCmdPacket;
+            if (pContext->bTextOutput)
+            {
+                FileSprintf(pArrResultFileName, "#ImageLeader(%s): BlockID:0x%llx PayloadType:0x%x Timestamp:0x%llx PixelFormat:0x%x SizeX:0x%x SizeY:0x%x OffsetX:0x%x OffsetY:0x%x\n\n"
+                																						, DevEnpName(stDevEnpNum, true, arrName)
+                																						, pImageLeader->ui64BlockID
+                                                                                                        , pImageLeader->ui16PayloadType
+                                                                                                        , pImageLeader->ui64Timestamp
+                                                                                                        , pImageLeader->ui32PixelFormat
+                                                                                                        , pImageLeader->ui32SizeX
+                                                                                                        , pImageLeader->ui32SizeY
+                                                                                                        , pImageLeader->ui32OffsetX
+                                                                                                        , pImageLeader->ui32OffsetY);
+            }
+
+            //BlockID应单调递增
+            if ((pDevEnpInfo->ui64FrameCount != 0) && (pImageLeader->ui64BlockID <= pDevEnpStatus->ui64BlockID))
+            {
+                StreamResync(pDevEnpStatus, pDevEnpInfo, STREAM_ERR_BLOCKID_ORDER, stDevEnpNum, pArrStr[0], pContext);
+                nRet = -1;
+            }
+
+            pDevEnpStatus->ui8Status = 1;   //U3VL ImageLeader
+            pDevEnpStatus->ui64BlockID = pImageLeader->ui64BlockID;  //保存ImageLeader中的BlockID
+            pDevEnpStatus->ui64PayloadSizeSum = 0; //将payload size总和清零
+            pDevEnpInfo->ui64FrameCount++;
+            pDevEnpStatus->ui64PayloadHash = FNV_OFFSET_BASIS;
+            pDevEnpInfo->ui32PixelFormat = pImageLeader->ui32PixelFormat;
+            pDevEnpInfo->ui32SizeX = pImageLeader->ui32SizeX;
+            pDevEnpInfo->ui32SizeY = pImageLeader->ui32SizeY;
+            pDevEnpInfo->ui64Timestamp = pImageLeader->ui64Timestamp;
+            pDevEnpInfo->ui64FrameSize = 0;
+            pDevEnpStatus->bSkipPayload = !FrameSampled(pContext, pDevEnpInfo);
+            EventTimelineOnLeader(&DeviceTableGet(&pContext->stDeviceTable, stDevEnpNum)->stEventTimeline, pImageLeader->ui64Timestamp);  //关联该帧之前的事件
+
+            if (pContext->bImageOutput && !pDevEnpStatus->bSkipPayload)
+            {
+                //创建文件夹和图像文件
+                memset(arrFileName, 0, FILENAME_SIZE);
+                int nDirLength = 0;
+                if (stDevEnpNum.ui16BusNum != 0)  //有总线号时文件夹为"总线_设备"
+                {
+                    nDirLength = sprintf(arrFileName, "./%03d_%03d", stDevEnpNum.ui16BusNum, stDevEnpNum.ui16DeviceNum);
+                }
+                else
+                {
+                    nDirLength = sprintf(arrFileName, "./%03d", stDevEnpNum.ui16DeviceNum);
+                }
+                if (access(arrFileName, F_OK) == -1)
+                {
+                    mkdir(arrFileName, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+                }
+
+                char arrTime[30] = {0};
+                memcpy(arrTime, pArrStr[0] + stOffset.ui16TimeOff, stOffset.ui16TimeLength);
+                arrTime[stOffset.ui16TimeLength] = '\0';
+                char *pTimeMs = strstr(arrTime, ".");
+                if (pTimeMs == NULL)
+                {
+                    printf("Not find ms\n");
+                    delete [] pCmdPacket;
+                    return -1;
+                }
+                uint16_t ui16TimeMs = strtol(pTimeMs + 1, NULL, 10);
+                sprintf(arrFileName + nDirLength, "/%03d_%03lld_%03d.%s", stDevEnpNum.ui16DeviceNum, pImageLeader->ui64BlockID, ui16TimeMs
+                                                                        , (pContext->pPngEncoder != NULL) ? "png" : "pgm");
+                strcpy(pDevEnpInfo->arrCurrentFileName, arrFileName);
+                if (pContext->pPngEncoder == NULL)  //PNG在收到Trailor后由编码线程创建
+                {
+                    FILE *fpImage = fopen(arrFileName, "w+");
+                    if (fpImage == NULL)
+                    {
+                        printf("Create image file fail!!!\n");
+                        delete [] pCmdPacket;
+                        return -1;
                     }
+                    fprintf(fpImage, "P5\n%u %u\n255\n", pImageLeader->ui32SizeX, pImageLeader->ui32SizeY);
+                    fclose(fpImage);
+                    fpImage = NULL;
                 }
+            }
+
+            //结果缓存记录该帧图像和各payload模块位置，回放时直接定位转换
+            pDevEnpInfo->ui32CacheFrame = 0;
+            if ((pContext->pCache != NULL) && !pDevEnpStatus->bSkipPayload && (pContext->bImageOutput || (pContext->nRawFd >= 0)))
+            {
+                pDevEnpInfo->ui32CacheFrame = CacheAddFrame(pContext->pCache, pDevEnpInfo, pImageLeader->ui64BlockID
+                                                          , pContext->bImageOutput ? pDevEnpInfo->arrCurrentFileName : NULL);
+            }
+
+            delete [] pCmdPacket;
+            pCmdPacket = NULL;
+        }
+        else if(strstr(arrPhase, "IN") != NULL)
+        {
+            StreamResync(pDevEnpStatus, pDevEnpInfo, STREAM_ERR_RESIDUAL, stDevEnpNum, pArrStr[0], pContext);
+            return -1;
+        }
+    }
+    else if (pDevEnpStatus->ui8Status == 1)
+    {
+        pDevEnpStatus->ui64PayloadSizeSum += PayloadAnalysis(pArrStr, nIndex, pContext, pDevEnpStatus, pDevEnpInfo);
+        pDevEnpStatus->ui8Status = 2;     //下一个模块属于payload  
+    }
+    else if (pDevEnpStatus->ui8Status == 2)  //图像数据payload模块
+    {
+        if (ui32Prefix == U3V_PREFIX_IMAGE_TRAILER)  //U3VT ImageTrailor
+        {
+            ///打印Trailor信息
+            char *pCmdPacket = new char[nIndex*ROW_LENGTH];
+            if (GetPacket(pArrStr, nIndex, stOffset, pCmdPacket) < 0)
+            {
+                pDevEnpInfo->arrErrCount[STREAM_ERR_BAD_HEX]++;
+            }
+            IMAGE_TRAILER *pImageTrailer = (IMAGE_TRAILER *)pCmdPacket;
+            if (pContext->bTextOutput)
+            {
+                FileSprintf(pArrResultFileName, "#ImageTrailor(%s): TrailerSize:0x%x BlockID:0x%llx Status:0x%x ValidPayloadSize:0x%llx SizeY:0x%x\n\n"
+                																						, DevEnpName(stDevEnpNum, true, arrName)
+                																						, pImageTrailer->ui16TrailerSize
+                                                                                                        , pImageTrailer->ui64BlockID
+                                                                                                        , pImageTrailer->ui16Status
+                                                                                                        , pImageTrailer->ui64ValidPayloadSize
+                                                                                                        , pImageTrailer->ui32SizeY);
+            }
+
+            uint64_t ui64PayloadSizeSum = pDevEnpStatus->ui64PayloadSizeSum;
+            pDevEnpStatus->ui8Status = 0;
+            pDevEnpStatus->ui64PayloadSizeSum = 0;
+            if (pDevEnpStatus->ui64BlockID != pImageTrailer->ui64BlockID) //判断Leader和Trailor的BlockID是否匹配
+            {
+                StreamResync(pDevEnpStatus, pDevEnpInfo, STREAM_ERR_BLOCKID_MISMATCH, stDevEnpNum, pArrStr[0], pContext);
+                nRet = -1;
+            }
+            if (ui64PayloadSizeSum != pImageTrailer->ui64ValidPayloadSize)
+            {
+                StreamResync(pDevEnpStatus, pDevEnpInfo, STREAM_ERR_PAYLOAD_SIZE, stDevEnpNum, pArrStr[0], pContext);
+                nRet = -1;
+            }
+            if ((nRet == 0) && (pContext->nRawFd >= 0) && !pDevEnpStatus->bSkipPayload)  //只输出完整且校验通过的抽样帧
+            {
+                RawStreamWriteFrame(pContext, pDevEnpInfo, pImageTrailer->ui64BlockID);
+            }
+            if (pContext->bImageOutput && (pContext->pPngEncoder != NULL) && !pDevEnpStatus->bSkipPayload)  //与PGM相同，校验失败的帧也输出
+            {
+                PngEncoderSubmit(pContext->pPngEncoder, pDevEnpInfo, pDevEnpInfo->arrCurrentFileName);
+            }
+            if (pDevEnpInfo->ui32CacheFrame != 0)
+            {
+                CACHE_FRAME *pCacheFrame = &pContext->pCache->pFrame[pDevEnpInfo->ui32CacheFrame - 1];
+                pCacheFrame->bTrailer = true;
+                pCacheFrame->bComplete = (nRet == 0);
+            }
+            if (pContext->pfnRecordSink != NULL)
+            {
+                U3V_RECORD stRecord;
+                memset(&stRecord, 0, sizeof(U3V_RECORD));
+                stRecord.ui8Type = RECORD_FRAME;
+                stRecord.stDevEnpNum = stDevEnpNum;
+                stRecord.ui32DeviceIndex = (uint32_t)(DeviceTableGet(&pContext->stDeviceTable, stDevEnpNum) - pContext->stDeviceTable.pDevice);
+                stRecord.ui16Status = pImageTrailer->ui16Status;
+                stRecord.ui64Key = pImageTrailer->ui64BlockID;
+                stRecord.ui64Length = ui64PayloadSizeSum;
+                stRecord.ui64Hash = pDevEnpStatus->ui64PayloadHash;
+                stRecord.ui32PixelFormat = pDevEnpInfo->ui32PixelFormat;
+                stRecord.ui32SizeX = pDevEnpInfo->ui32SizeX;
+                stRecord.ui32SizeY = pDevEnpInfo->ui32SizeY;
+                stRecord.ui64BlockNum = pContext->ui64BlockNum;
+                stRecord.ui64Time = GetBlockTime(pArrStr[0], stOffset);
+                stRecord.ui64WireLength = GetBlockLength(pArrStr[0], stOffset);
+                pContext->pfnRecordSink(pContext->pSinkUser, stRecord);
+            }
+            delete [] pCmdPacket;
+            pCmdPacket = NULL;
+        }   
+        else  //payload数据
+        {
+            //payload写入文件，并计算payload累加和
+            pDevEnpStatus->ui64PayloadSizeSum += PayloadAnalysis(pArrStr, nIndex, pContext, pDevEnpStatus, pDevEnpInfo);
+        }
+    }
+    return nRet;
+
+}
+
+//-----------------------------------------------------------
+/*
+\brief		输出各设备端口的帧数和错误统计，log结束时未收到Trailor的帧计为残帧
+\parm   	pDevEnpTable			设备端口状态表
+\parm   	pArrResultFileName		解析结果文件路径，校验模式下为NULL
+\return		错误总数
+*/
+//-----------------------------------------------------------
+uint64_t StreamErrorReport(DEV_ENP_TABLE *pDevEnpTable, char *pArrResultFileName)
+{
+    uint64_t ui64ErrorSum = 0;
+    char arrName[DEV_ENP_NAME_SIZE];
+    for (uint32_t i = 0; i < pDevEnpTable->ui32Num; ++i)
+    {
+        DEV_ENP_STATUS *pDevEnpStatus = &pDevEnpTable->pHot[i];
+        DEV_ENP_INFO *pDevEnpInfo = &pDevEnpTable->pCold[i];
+        if (pDevEnpStatus->ui8Status != 0)
+        {
+            pDevEnpInfo->arrErrCount[STREAM_ERR_NO_TRAILER]++;
+            pDevEnpStatus->ui8Status = 0;
+        }
+
+        uint64_t ui64StreamError = 0;
+        for (int k = 0; k < STREAM_ERR_NUM; ++k)
+        {
+            ui64StreamError += pDevEnpInfo->arrErrCount[k];
+        }
+        if ((pDevEnpInfo->ui64FrameCount == 0) && (ui64StreamError == 0))
+        {
+            continue;
+        }
+        ui64ErrorSum += ui64StreamError;
+
+        FileSprintf(pArrResultFileName, "#Stream(%s): Frames:%llu Errors:%llu", DevEnpName(pDevEnpInfo->stDevEnpNum, true, arrName)
+                                                                              , pDevEnpInfo->ui64FrameCount
+                                                                              , ui64StreamError);
+        for (int k = 0; k < STREAM_ERR_NUM; ++k)
+        {
+            if (pDevEnpInfo->arrErrCount[k] != 0)
+            {
+                FileSprintf(pArrResultFileName, " %s:%u", g_arrStreamErrorMsg[k], pDevEnpInfo->arrErrCount[k]);
+            }
+        }
+        FileSprintf(pArrResultFileName, "\n");
+    }
+    return ui64ErrorSum;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		初始化log解析上下文，默认输出解析文本和图像
+\parm   	pContext				log解析上下文
+\parm   	pArrResultFileName		解析结果文件路径，为NULL时只在控制台输出
+\return
+*/
+//-----------------------------------------------------------
+void LogContextInit(LOG_CONTEXT *pContext, char *pArrResultFileName)
+{
+    memset(pContext, 0, sizeof(LOG_CONTEXT));
+    pContext->pArrResultFileName = pArrResultFileName;
+    pContext->bTextOutput = true;
+    pContext->bErrorOutput = true;
+    pContext->bImageOutput = true;
+    pContext->bDecodePayload = true;
+    pContext->nRawFd = -1;
+
+    //设备端口状态表和设备状态表，按出现顺序存放，容量按需增长
+    KeyIndexMapInit(&pContext->stDevEnpTable.stMap, DEV_ENP_MAP_INIT_SIZE);
+    KeyIndexMapInit(&pContext->stDeviceTable.stMap, DEV_ENP_MAP_INIT_SIZE);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		释放log解析上下文
+\parm   	pContext				log解析上下文
+\return
+*/
+//-----------------------------------------------------------
+void LogContextRelease(LOG_CONTEXT *pContext)
+{
+    DEVICE_TABLE *pDeviceTable = &pContext->stDeviceTable;
+    for (uint32_t i = 0; i < pDeviceTable->ui32Num; ++i)
+    {
+        delete [] pDeviceTable->pDevice[i].stEventTimeline.pRing;
+    }
+    delete [] (char *)pDeviceTable->pDevice;
+    pDeviceTable->pDevice = NULL;
+    KeyIndexMapRelease(&pDeviceTable->stMap);
+
+    DEV_ENP_TABLE *pDevEnpTable = &pContext->stDevEnpTable;
+    for (uint32_t i = 0; i < pDevEnpTable->ui32Num; ++i)
+    {
+        delete [] pDevEnpTable->pCold[i].pFrameBuffer;
+    }
+    delete [] (char *)pDevEnpTable->pHot;
+    pDevEnpTable->pHot = NULL;
+    delete [] (char *)pDevEnpTable->pCold;
+    pDevEnpTable->pCold = NULL;
+    KeyIndexMapRelease(&pDevEnpTable->stMap);
+}
+
+//-----------------------------------------------------------
+/*
+\brief  读取log表头，计算各数据段偏移量，并定位到第一个数据模块
+\parm   pReader                     log模块读取器
+\parm   fpData                      文件指针
+\parm   stOffset                    输出各数据段偏移量结构体
+\return 0 成功; -1 log格式错误
+*/
+//-----------------------------------------------------------
+int LogReaderOpen(LOG_READER *pReader, FILE *fpData, LOCATION_OFFSET &stOffset)
+{
+    char *arrTemp = pReader->arrTemp;   //存放一行数据
+    char *pTemp = NULL;
+    char *pStatus = NULL;
+    bool bStatus = false;
+    char arrCmdPhase[ARR_CMD_PHASE_LENGTH];
+
+    pReader->fpData = fpData;
+    pReader->bBlockRemain = false;
+    pReader->bOversize = false;
+    pReader->bEnd = false;
+    memset(arrTemp, 0, ROW_LENGTH*sizeof(char));
+    
+    while(!bStatus)
+    {
+        pStatus = fgets(arrTemp, ROW_LENGTH, fpData);
+        if (pStatus == NULL)
+        {
+            printf("Not find Description or Device or Data or Time!\n");
+            return -1;
+        }   
+        bStatus = ((strstr(arrTemp, "Description") != NULL) && (strstr(arrTemp, "Device") != NULL)\
+                                                            && (strstr(arrTemp, "Data") != NULL)\
+                                                            && (strstr(arrTemp, "Time") != NULL));
+    }
+    memcpy(pReader->arrHeader[0], arrTemp, ROW_LENGTH);
+
+    stOffset.ui16PhaseOff = strstr(arrTemp, "Phase") - strstr(arrTemp, "Device");
+    stOffset.ui16DataOff = strstr(arrTemp, "Data") - strstr(arrTemp, "Device");
+    stOffset.ui16DescriptOff = strstr(arrTemp, "Description") - strstr(arrTemp, "Device");
+    stOffset.ui16CmdPhaseOff = strstr(arrTemp, "Cmd.Phase.Ofs(rep)") - strstr(arrTemp, "Device");
+    stOffset.ui16TimeOff = strstr(arrTemp, "Time") - strstr(arrTemp, "Device");
+    stOffset.ui16LenOff = strstr(arrTemp, "Length") - strstr(arrTemp, "Device");
+
+
+    pStatus = fgets(arrTemp, ROW_LENGTH, fpData);
+    if (pStatus == NULL)
+    {
+        printf("Read no data!\n");
+        return -1;
+    }
+    memcpy(pReader->arrHeader[1], arrTemp, ROW_LENGTH);
+
+    stOffset.ui16DataLength = CalSegLength(arrTemp + stOffset.ui16DataOff);
+    stOffset.ui16PhaseLength = CalSegLength(arrTemp + stOffset.ui16PhaseOff);
+    stOffset.ui16CmdPhaseLength = CalSegLength(arrTemp + stOffset.ui16CmdPhaseOff);
+    stOffset.ui16TimeLength = CalSegLength(arrTemp + stOffset.ui16TimeOff);
+    stOffset.ui16LenLength = CalSegLength(arrTemp + stOffset.ui16LenOff);
+
+
+    //根据CmdPhase特征提取各个单独数据模块
+    while(pTemp == NULL)
+    {
+        pStatus = fgets(arrTemp, ROW_LENGTH, fpData);
+        if (pStatus == NULL)
+        {
+            printf("Not find data\n");
+            return -1;
+        }
+        memset(arrCmdPhase, 0, ARR_CMD_PHASE_LENGTH);
+        memcpy(arrCmdPhase, arrTemp + stOffset.ui16CmdPhaseOff, stOffset.ui16CmdPhaseLength);
+        arrCmdPhase[stOffset.ui16CmdPhaseLength] = '\0';
+        pTemp = strstr(arrCmdPhase, ".");
+    }
+
+    pReader->ui16CmdPhaseOff = pTemp - arrCmdPhase;
+    memset(pReader->arrCMP1, 0, ARR_CMD_PHASE_LENGTH);
+    memcpy(pReader->arrCMP1, arrTemp + stOffset.ui16CmdPhaseOff, pReader->ui16CmdPhaseOff);
+    pReader->arrCMP1[pReader->ui16CmdPhaseOff] = '\0';
+    pReader->ui64NextOffset = ftell(fpData);
+    pReader->ui64TempOffset = pReader->ui64NextOffset - strlen(arrTemp);
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief  读取下一个数据模块(CmdPhase编号相同的连续行)，先跳过上一模块未读取的行
+\       U3V前缀模块整块读入，超过CMD_LINE_NUM行时只读入前CMD_LINE_NUM行并置bOversize；
+\       其它模块(payload)只读入首行，其余行由LogReaderNextLine逐行读取
+\parm   pReader                     log模块读取器
+\parm   stOffset                    各数据段偏移量结构体
+\parm  	pArrStr  					存储单个模块数据的二维数组
+\parm   nIndex                      输出模块的行数
+\parm   pHead                       输出模块首行开头的前缀和CCD
+\return 0 读到模块; 1 已到文件末尾
+*/
+//-----------------------------------------------------------
+int LogReaderNext(LOG_READER *pReader, const LOCATION_OFFSET &stOffset, char **pArrStr, int &nIndex, BLOCK_HEAD *pHead)
+{
+    while (pReader->bBlockRemain)
+    {
+        pReader->bBlockRemain = LogReaderAdvance(pReader, stOffset);
+    }
+    if (pReader->bEnd)
+    {
+        return 1;
+    }
+
+    nIndex = 0;
+    pReader->bOversize = false;
+    pReader->ui64BlockOffset = pReader->ui64TempOffset;
+    memcpy(pArrStr[nIndex++], pReader->arrTemp, ROW_LENGTH);
+    pReader->bBlockRemain = LogReaderAdvance(pReader, stOffset);
+
+    if (!IsU3VPrefix(GetBlockHead(pArrStr[0], stOffset, pHead)))
+    {
+        return 0;
+    }
+    //超长模块的其余行留在读取器中：作为payload时逐行读取，作为协议包时由下次调用跳过
+    while (pReader->bBlockRemain)
+    {
+        if (nIndex >= CMD_LINE_NUM)
+        {
+            pReader->bOversize = true;
+            break;
+        }
+        memcpy(pArrStr[nIndex++], pReader->arrTemp, ROW_LENGTH);
+        pReader->bBlockRemain = LogReaderAdvance(pReader, stOffset);
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		初始化寄存器访问统计
+\parm   	pProfile				寄存器访问统计上下文
+\parm   	ui32TopNum				输出的最频繁访问地址个数
+\return
+*/
+//-----------------------------------------------------------
+void ProfileInit(PROFILE_CONTEXT *pProfile, uint32_t ui32TopNum)
+{
+    memset(pProfile, 0, sizeof(PROFILE_CONTEXT));
+    pProfile->ui32TopNum = ui32TopNum;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		释放寄存器访问统计
+\parm   	pProfile				寄存器访问统计上下文
+\return
+*/
+//-----------------------------------------------------------
+void ProfileRelease(PROFILE_CONTEXT *pProfile)
+{
+    for (uint32_t i = 0; i < pProfile->ui32Num; ++i)
+    {
+        REG_PROFILE *pDevice = &pProfile->pDevice[i];
+        if (pDevice->stMap.pKey != NULL)
+        {
+            KeyIndexMapRelease(&pDevice->stMap);
+        }
+        delete [] (char *)pDevice->pStat;
+        pDevice->pStat = NULL;
+    }
+    delete [] (char *)pProfile->pDevice;
+    pProfile->pDevice = NULL;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		获取记录所属设备的寄存器直方图，首次出现时新建
+\parm   	pProfile				寄存器访问统计上下文
+\parm   	stRecord				控制事务记录
+\return		设备寄存器直方图
+*/
+//-----------------------------------------------------------
+REG_PROFILE *ProfileDeviceGet(PROFILE_CONTEXT *pProfile, const U3V_RECORD &stRecord)
+{
+    uint32_t ui32Index = stRecord.ui32DeviceIndex;
+    if (ui32Index >= pProfile->ui32Capacity)
+    {
+        uint32_t ui32Capacity = (pProfile->ui32Capacity == 0) ? DEV_ENP_MAP_INIT_SIZE : pProfile->ui32Capacity;
+        while (ui32Capacity <= ui32Index)
+        {
+            ui32Capacity *= 2;
+        }
+        pProfile->pDevice = (REG_PROFILE *)GrowArray(pProfile->pDevice, pProfile->ui32Num, ui32Capacity, sizeof(REG_PROFILE));
+        pProfile->ui32Capacity = ui32Capacity;
+    }
+    if (ui32Index >= pProfile->ui32Num)
+    {
+        pProfile->ui32Num = ui32Index + 1;
+    }
+
+    REG_PROFILE *pDevice = &pProfile->pDevice[ui32Index];
+    if (pDevice->stMap.pKey == NULL)
+    {
+        KeyIndexMapInit(&pDevice->stMap, REG_MAP_INIT_SIZE);
+        pDevice->stDevEnpNum = stRecord.stDevEnpNum;
+        pDevice->stDevEnpNum.ui16EndpointNum = 0;
+    }
+    return pDevice;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		获取寄存器地址的访问统计，首次出现时新建
+\parm   	pDevice					设备寄存器直方图
+\parm   	ui64Address				寄存器地址
+\return		访问统计，表增长后原有指针失效
+*/
+//-----------------------------------------------------------
+REG_STAT *RegStatGet(REG_PROFILE *pDevice, uint64_t ui64Address)
+{
+    uint32_t ui32Index = KeyIndexMapGet(&pDevice->stMap, ui64Address, pDevice->ui32Num);
+    if (ui32Index == pDevice->ui32Num)   //新地址
+    {
+        if (pDevice->ui32Num == pDevice->ui32Capacity)
+        {
+            uint32_t ui32Capacity = (pDevice->ui32Capacity == 0) ? REG_MAP_INIT_SIZE / 2 : pDevice->ui32Capacity * 2;
+            pDevice->pStat = (REG_STAT *)GrowArray(pDevice->pStat, pDevice->ui32Num, ui32Capacity, sizeof(REG_STAT));
+            pDevice->ui32Capacity = ui32Capacity;
+        }
+        pDevice->pStat[ui32Index].ui64Address = ui64Address;
+        pDevice->pStat[ui32Index].ui64IntervalMin = UINT64_MAX;
+        pDevice->ui32Num++;
+    }
+    return &pDevice->pStat[ui32Index];
+}
+
+//-----------------------------------------------------------
+/*
+\brief		寄存器统计模式的事务记录回调：按设备和地址累计读写次数、字节数、错误状态和访问间隔
+\parm   	pUser					PROFILE_CONTEXT指针
+\parm   	stRecord				事务记录
+\return
+*/
+//-----------------------------------------------------------
+void ProfileRecordSink(void *pUser, const U3V_RECORD &stRecord)
+{
+    PROFILE_CONTEXT *pProfile = (PROFILE_CONTEXT *)pUser;
+    if ((stRecord.ui8Type != RECORD_CONTROL) || (stRecord.ui16CommandID == U3V_EVENT_CMD))
+    {
+        return;
+    }
+
+    REG_PROFILE *pDevice = ProfileDeviceGet(pProfile, stRecord);
+    pDevice->ui64ControlBytes += stRecord.ui64WireLength;
+    bool bCommand = (stRecord.ui16CommandID == U3V_READ_MEM_CMD) || (stRecord.ui16CommandID == U3V_WRITE_MEM_CMD);
+    if (bCommand)
+    {
+        pDevice->ui64CommandNum++;
+    }
+    else
+    {
+        pDevice->ui64AckNum++;
+    }
+    if (stRecord.ui64Key == UINT64_MAX)
+    {
+        pDevice->ui64UnmatchedAckNum++;
+        return;
+    }
+
+    REG_STAT *pStat = RegStatGet(pDevice, stRecord.ui64Key);
+    if (bCommand)
+    {
+        //相邻两次读写命令的间隔即轮询周期
+        if (((pStat->ui64ReadCount != 0) || (pStat->ui64WriteCount != 0)) && (stRecord.ui64Time >= pStat->ui64LastTime))
+        {
+            uint64_t ui64Interval = stRecord.ui64Time - pStat->ui64LastTime;
+            pStat->ui64IntervalSum += ui64Interval;
+            pStat->ui64IntervalMin = (ui64Interval < pStat->ui64IntervalMin) ? ui64Interval : pStat->ui64IntervalMin;
+            pStat->ui64IntervalMax = (ui64Interval > pStat->ui64IntervalMax) ? ui64Interval : pStat->ui64IntervalMax;
+        }
+        pStat->ui64LastTime = stRecord.ui64Time;
+        if (stRecord.ui16CommandID == U3V_READ_MEM_CMD)
+        {
+            pStat->ui64ReadCount++;
+        }
+        else
+        {
+            pStat->ui64WriteCount++;
+        }
+        pStat->ui64Bytes += stRecord.ui64Length;
+    }
+    else if (stRecord.ui16Status != 0)
+    {
+        pStat->ui64ErrorCount++;
+    }
+    else if ((stRecord.ui16CommandID == U3V_READ_MEM_ACK) && (stRecord.ui64Length >= sizeof(uint64_t)))
+    {
+        //读到引导寄存器中的基址后，后续访问可按SBRM、SIRM、EIRM命名
+        if (stRecord.ui64Key == SBRM_ADDR)
+        {
+            pDevice->ui64SbrmBase = stRecord.ui64Value;
+        }
+        else if ((pDevice->ui64SbrmBase != 0) && (stRecord.ui64Key == pDevice->ui64SbrmBase + 0x20))
+        {
+            pDevice->ui64SirmBase = stRecord.ui64Value;
+        }
+        else if ((pDevice->ui64SbrmBase != 0) && (stRecord.ui64Key == pDevice->ui64SbrmBase + EIRM_ADDR - SBRM_ADDR))
+        {
+            pDevice->ui64EirmBase = stRecord.ui64Value;
+        }
+    }
+}
+
+//-----------------------------------------------------------
+/*
+\brief		获取寄存器的符号名称，ABRM按绝对地址，SBRM、SIRM、EIRM按已知基址的偏移
+\parm   	pDevice					设备寄存器直方图
+\parm   	ui64Address				寄存器地址
+\parm   	pName					名称缓冲区，至少REG_NAME_SIZE字节
+\return		pName，未知地址为空字符串
+*/
+//-----------------------------------------------------------
+const char *GetRegisterName(const REG_PROFILE *pDevice, uint64_t ui64Address, char *pName)
+{
+    pName[0] = '\0';
+    if ((pDevice->ui64SbrmBase != 0) && (ui64Address >= pDevice->ui64SbrmBase))
+    {
+        for (uint32_t i = 0; i < sizeof(g_arrSbrmName) / sizeof(REG_NAME); ++i)
+        {
+            if (ui64Address - pDevice->ui64SbrmBase == g_arrSbrmName[i].ui64Address)
+            {
+                sprintf(pName, "SBRM %s", g_arrSbrmName[i].pName);
+                return pName;
+            }
+        }
+    }
+    if ((pDevice->ui64SirmBase != 0) && (ui64Address >= pDevice->ui64SirmBase) && (ui64Address - pDevice->ui64SirmBase < 0x40))
+    {
+        sprintf(pName, "SIRM+0x%llx", (unsigned long long)(ui64Address - pDevice->ui64SirmBase));
+        return pName;
+    }
+    if ((pDevice->ui64EirmBase != 0) && (ui64Address >= pDevice->ui64EirmBase) && (ui64Address - pDevice->ui64EirmBase < 0x20))
+    {
+        sprintf(pName, "EIRM+0x%llx", (unsigned long long)(ui64Address - pDevice->ui64EirmBase));
+        return pName;
+    }
+    for (uint32_t i = 0; i < sizeof(g_arrAbrmName) / sizeof(REG_NAME); ++i)
+    {
+        if (ui64Address == g_arrAbrmName[i].ui64Address)
+        {
+            sprintf(pName, "ABRM %s", g_arrAbrmName[i].pName);
+            break;
+        }
+    }
+    return pName;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		按地址升序排列寄存器统计
+\parm   	pStat1					REG_STAT元素
+\parm   	pStat2					REG_STAT元素
+\return		<0 pStat1在前; 0 相同; >0 pStat2在前
+*/
+//-----------------------------------------------------------
+int RegStatAddressCompare(const void *pStat1, const void *pStat2)
+{
+    uint64_t ui64Address1 = ((const REG_STAT *)pStat1)->ui64Address;
+    uint64_t ui64Address2 = ((const REG_STAT *)pStat2)->ui64Address;
+    return (ui64Address1 < ui64Address2) ? -1 : ((ui64Address1 > ui64Address2) ? 1 : 0);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		按访问次数降序排列寄存器统计，次数相同时按字节数降序、地址升序
+\parm   	pStat1					REG_STAT指针元素
+\parm   	pStat2					REG_STAT指针元素
+\return		<0 pStat1在前; 0 相同; >0 pStat2在前
+*/
+//-----------------------------------------------------------
+int RegStatHotCompare(const void *pStat1, const void *pStat2)
+{
+    const REG_STAT *pStatA = *(const REG_STAT * const *)pStat1;
+    const REG_STAT *pStatB = *(const REG_STAT * const *)pStat2;
+    uint64_t ui64CountA = pStatA->ui64ReadCount + pStatA->ui64WriteCount;
+    uint64_t ui64CountB = pStatB->ui64ReadCount + pStatB->ui64WriteCount;
+    if (ui64CountA != ui64CountB)
+    {
+        return (ui64CountA > ui64CountB) ? -1 : 1;
+    }
+    if (pStatA->ui64Bytes != pStatB->ui64Bytes)
+    {
+        return (pStatA->ui64Bytes > pStatB->ui64Bytes) ? -1 : 1;
+    }
+    return RegStatAddressCompare(pStatA, pStatB);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		输出一个寄存器地址的访问统计
+\parm   	pDevice					设备寄存器直方图
+\parm   	pStat					寄存器访问统计
+\parm   	pArrResultFileName		解析结果文件路径
+\return
+*/
+//-----------------------------------------------------------
+void RegStatPrint(const REG_PROFILE *pDevice, const REG_STAT *pStat, char *pArrResultFileName)
+{
+    char arrName[REG_NAME_SIZE];
+    uint64_t ui64AccessCount = pStat->ui64ReadCount + pStat->ui64WriteCount;
+    FileSprintf(pArrResultFileName, "    0x%08llx Reads:%llu Writes:%llu Bytes:%llu Errors:%llu", pStat->ui64Address
+                                                                                            , pStat->ui64ReadCount
+                                                                                            , pStat->ui64WriteCount
+                                                                                            , pStat->ui64Bytes
+                                                                                            , pStat->ui64ErrorCount);
+    if (ui64AccessCount > 1)
+    {
+        FileSprintf(pArrResultFileName, " Interval(min/avg/max):%llu/%llu/%llu us", pStat->ui64IntervalMin
+                                                                                  , pStat->ui64IntervalSum / (ui64AccessCount - 1)
+                                                                                  , pStat->ui64IntervalMax);
+    }
+    if (GetRegisterName(pDevice, pStat->ui64Address, arrName)[0] != '\0')
+    {
+        FileSprintf(pArrResultFileName, " %s", arrName);
+    }
+    FileSprintf(pArrResultFileName, "\n");
+}
+
+//-----------------------------------------------------------
+/*
+\brief		输出各设备按地址排序的寄存器访问直方图、最频繁访问的地址及控制通道带宽占比
+\parm   	pProfile				寄存器访问统计上下文
+\parm   	pArrResultFileName		解析结果文件路径
+\return
+*/
+//-----------------------------------------------------------
+void ProfileReport(PROFILE_CONTEXT *pProfile, char *pArrResultFileName)
+{
+    char arrName[DEV_ENP_NAME_SIZE];
+    uint64_t ui64ControlBytes = 0;
+    for (uint32_t i = 0; i < pProfile->ui32Num; ++i)
+    {
+        REG_PROFILE *pDevice = &pProfile->pDevice[i];
+        if (pDevice->stMap.pKey == NULL)
+        {
+            continue;
+        }
+        ui64ControlBytes += pDevice->ui64ControlBytes;
+        FileSprintf(pArrResultFileName, "#RegisterProfile(%s): Commands:%llu ACKs:%llu UnmatchedACKs:%llu Addresses:%u ControlBytes:%llu\n"
+                                                                                            , DevEnpName(pDevice->stDevEnpNum, false, arrName)
+                                                                                            , pDevice->ui64CommandNum
+                                                                                            , pDevice->ui64AckNum
+                                                                                            , pDevice->ui64UnmatchedAckNum
+                                                                                            , pDevice->ui32Num
+                                                                                            , pDevice->ui64ControlBytes);
+        qsort(pDevice->pStat, pDevice->ui32Num, sizeof(REG_STAT), RegStatAddressCompare);
+        for (uint32_t j = 0; j < pDevice->ui32Num; ++j)
+        {
+            RegStatPrint(pDevice, &pDevice->pStat[j], pArrResultFileName);
+        }
+
+        uint32_t ui32TopNum = (pDevice->ui32Num < pProfile->ui32TopNum) ? pDevice->ui32Num : pProfile->ui32TopNum;
+        if (ui32TopNum != 0)
+        {
+            const REG_STAT **pArrHot = new const REG_STAT *[pDevice->ui32Num];
+            for (uint32_t j = 0; j < pDevice->ui32Num; ++j)
+            {
+                pArrHot[j] = &pDevice->pStat[j];
+            }
+            qsort(pArrHot, pDevice->ui32Num, sizeof(const REG_STAT *), RegStatHotCompare);
+            FileSprintf(pArrResultFileName, "#RegisterTop%u(%s):\n", ui32TopNum, arrName);
+            for (uint32_t j = 0; j < ui32TopNum; ++j)
+            {
+                RegStatPrint(pDevice, pArrHot[j], pArrResultFileName);
+            }
+            delete [] pArrHot;
+        }
+        FileSprintf(pArrResultFileName, "\n");
+    }
+
+    FileSprintf(pArrResultFileName, "#ControlChannel: Bytes:%llu TotalBytes:%llu Share:%.2f%%\n", ui64ControlBytes
+                                                                                               , pProfile->ui64TotalBytes
+                                                                                               , (pProfile->ui64TotalBytes == 0) ? 0.0 : 100.0 * ui64ControlBytes / pProfile->ui64TotalBytes);
+}
+
+//-----------------------------------------------------------
+/*
+\brief  从原始数据中，提取出模块数据，并调用ModuleAnalysis函数解析
+\parm   fpData                      文件指针
+\parm  	pArrStr  					存储单个模块数据的二维数组
+\parm   pArrResultFileName          解析结果文件路径，校验模式下为NULL
+\parm   stOption                    运行选项
+\parm   ui64ErrorCount              输出协议错误总数与出错模块数之和，非0时校验失败
+\parm   pCache                      结果缓存，为NULL时不记录
+\return
+*/
+//-----------------------------------------------------------
+int LogAnalysis(FILE *fpData, char **pArrStr, char *pArrResultFileName, const RUN_OPTION &stOption, uint64_t &ui64ErrorCount, RESULT_CACHE *pCache)
+{
+    LOG_READER stReader;
+    LOG_CONTEXT stContext;
+    PROFILE_CONTEXT stProfile;
+    int nIndex = 0;
+    int nRet = 0;
+    uint64_t ui64ErrorBlockNum = 0;
+
+    LogContextInit(&stContext, pArrResultFileName);
+    ProfileInit(&stProfile, stOption.ui32TopNum);
+    if (stOption.bValidate || stOption.bProfile)
+    {
+        stContext.bTextOutput = false;
+        stContext.bImageOutput = false;
+    }
+    if (stOption.bProfile)  //校验模式仍转换payload，检查非法字符和Length段
+    {
+        stContext.bDecodePayload = false;
+    }
+    if (stOption.bProfile)
+    {
+        stContext.pfnRecordSink = ProfileRecordSink;
+        stContext.pSinkUser = &stProfile;
+    }
+    stContext.ui32FramesPerStream = stOption.ui32FramesPerStream;
+    stContext.ui32EveryNthFrame = stOption.ui32EveryNthFrame;
+    stContext.ui64MaxBytes = stOption.ui64MaxBytes;
+    bool bSample = (stOption.ui32FramesPerStream != 0) || (stOption.ui32EveryNthFrame > 1) || (stOption.ui64MaxBytes != 0);
+    if (stOption.nRawFd >= 0)   //完整帧输出到原始帧流，不再写图像文件
+    {
+        stContext.nRawFd = stOption.nRawFd;
+        stContext.bRawHeader = stOption.bRawHeader;
+        stContext.bImageOutput = false;
+    }
+
+    stContext.pReader = &stReader;
+    if (LogReaderOpen(&stReader, fpData, stContext.stOffset) != 0)
+    {
+        LogContextRelease(&stContext);
+        ProfileRelease(&stProfile);
+        return -1;
+    }
+    stContext.pCache = pCache;
+    stContext.pPngEncoder = stOption.pPngEncoder;
+    if (pCache != NULL)
+    {
+        pCache->stHeader.stOffset = stContext.stOffset;
+    }
+    if (stContext.bTextOutput)
+    {
+        FileSprintf(pArrResultFileName, "%s", stReader.arrHeader[0]);
+        FileSprintf(pArrResultFileName, "%s", stReader.arrHeader[1]);
+    }
+
+    uint16_t ui16LoopOverFlow = 0;
+    //结束条件有两个：1 读取文件末尾； 2 模块数超过LOG_BLOCK_NUM则退出解析;
+    while (ui16LoopOverFlow < LOG_BLOCK_NUM)
+    {
+        nRet = LogReaderNext(&stReader, stContext.stOffset, pArrStr, nIndex, &stContext.stBlockHead);
+        if (nRet != 0)
+        {
+            break;
+        }
+
+        stContext.ui64BlockNum++;
+        if (stOption.bProfile)
+        {
+            stProfile.ui64TotalBytes += GetBlockLength(pArrStr[0], stContext.stOffset);
+        }
+        if (ModuleAnalysis(pArrStr, nIndex, &stContext) != 0)
+        {
+            ui64ErrorBlockNum++;
+        }
+        ui16LoopOverFlow++;
+    }
+
+    if (nRet >= 0)
+    {
+        if (stOption.bProfile)
+        {
+            ProfileReport(&stProfile, pArrResultFileName);
+        }
+        EventTimelineReport(&stContext.stDeviceTable, pArrResultFileName);
+        ui64ErrorCount = StreamErrorReport(&stContext.stDevEnpTable, pArrResultFileName);
+        if (bSample && stContext.bDecodePayload)
+        {
+            FileSprintf(pArrResultFileName, "#Sample: SampledFrames:%llu SampledBytes:%llu\n", stContext.ui64SampledFrames, stContext.ui64SampledBytes);
+        }
+        FileSprintf(pArrResultFileName, "#Blocks:%llu ErrorBlocks:%llu Errors:%llu\n", stContext.ui64BlockNum, ui64ErrorBlockNum, ui64ErrorCount);
+        //设备号等无法解析的模块只计入出错模块数，同样使校验失败
+        ui64ErrorCount += ui64ErrorBlockNum;
+    }
+    LogContextRelease(&stContext);
+    ProfileRelease(&stProfile);
+    return (nRet < 0) ? -1 : 0;
+}   
+
+//-----------------------------------------------------------
+/*
+\brief		生成结果缓存的键：输入文件大小、修改时间、抽样内容哈希，解析器版本和影响输出的选项
+\parm   	fpData					log文件指针，读取位置不变
+\parm   	stOption				运行选项
+\parm   	pHeader					输出缓存文件头，只填写键部分
+\return		0 成功; -1 读取文件失败
+*/
+//-----------------------------------------------------------
+int CacheKeyInit(FILE *fpData, const RUN_OPTION &stOption, CACHE_HEADER *pHeader)
+{
+    memset(pHeader, 0, sizeof(CACHE_HEADER));
+    memcpy(pHeader->arrMagic, CACHE_MAGIC, sizeof(pHeader->arrMagic));
+    pHeader->ui32Version = CACHE_VERSION;
+
+    int nFd = fileno(fpData);
+    struct stat stFileStat;
+    if (fstat(nFd, &stFileStat) != 0)
+    {
+        return -1;
+    }
+    pHeader->ui64FileSize = stFileStat.st_size;
+    pHeader->i64MtimeSec = stFileStat.st_mtim.tv_sec;
+    pHeader->i64MtimeNsec = stFileStat.st_mtim.tv_nsec;
+
+    //均匀抽取首尾及中间共CACHE_SAMPLE_NUM个片段，大文件也只读取固定字节数
+    char arrSample[CACHE_SAMPLE_SIZE];
+    uint64_t ui64Step = 0;
+    if (pHeader->ui64FileSize > CACHE_SAMPLE_SIZE)
+    {
+        ui64Step = (pHeader->ui64FileSize - CACHE_SAMPLE_SIZE) / (CACHE_SAMPLE_NUM - 1);
+    }
+    uint64_t ui64Hash = FNV_OFFSET_BASIS;
+    for (int i = 0; i < CACHE_SAMPLE_NUM; ++i)
+    {
+        ssize_t nRead = pread(nFd, arrSample, CACHE_SAMPLE_SIZE, i * ui64Step);
+        if (nRead < 0)
+        {
+            return -1;
+        }
+        ui64Hash = HashBytes(ui64Hash, arrSample, nRead);
+    }
+    pHeader->ui64ContentHash = ui64Hash;
+
+    //原始帧流的路径、是否带帧头和PNG压缩级别只影响回放时的写出，不参与哈希
+    bool arrMode[4] = {stOption.bValidate, stOption.bProfile, stOption.pRawStreamPath != NULL, stOption.bPng};
+    ui64Hash = HashBytes(FNV_OFFSET_BASIS, arrMode, sizeof(arrMode));
+    ui64Hash = HashBytes(ui64Hash, &stOption.ui32TopNum, sizeof(stOption.ui32TopNum));
+    ui64Hash = HashBytes(ui64Hash, &stOption.ui32FramesPerStream, sizeof(stOption.ui32FramesPerStream));
+    ui64Hash = HashBytes(ui64Hash, &stOption.ui32EveryNthFrame, sizeof(stOption.ui32EveryNthFrame));
+    ui64Hash = HashBytes(ui64Hash, &stOption.ui64MaxBytes, sizeof(stOption.ui64MaxBytes));
+    pHeader->ui64OptionHash = ui64Hash;
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		创建结果缓存临时文件，解析过程中FileSprintf输出的文本同时写入
+\parm   	pCache					结果缓存
+\parm   	pTempFileName			缓存临时文件路径
+\parm   	stKey					CacheKeyInit生成的缓存文件头
+\return		0 成功; -1 创建失败
+*/
+//-----------------------------------------------------------
+int CacheBegin(RESULT_CACHE *pCache, const char *pTempFileName, const CACHE_HEADER &stKey)
+{
+    memset(pCache, 0, sizeof(RESULT_CACHE));
+    pCache->stHeader = stKey;
+    pCache->fpCache = fopen(pTempFileName, "wb");
+    if (pCache->fpCache == NULL)
+    {
+        printf("Create result cache fail!!!\n");
+        return -1;
+    }
+    fwrite(&pCache->stHeader, sizeof(CACHE_HEADER), 1, pCache->fpCache);  //占位，解析结束后重写
+    g_fpTextCache = pCache->fpCache;
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		按所属帧、log偏移排序payload模块，同一帧的模块在缓存中连续存放
+\parm   	pSpan1					payload模块1
+\parm   	pSpan2					payload模块2
+\return		qsort比较结果
+*/
+//-----------------------------------------------------------
+int CacheSpanCompare(const void *pSpan1, const void *pSpan2)
+{
+    const CACHE_SPAN *pA = (const CACHE_SPAN *)pSpan1;
+    const CACHE_SPAN *pB = (const CACHE_SPAN *)pSpan2;
+    if (pA->ui32FrameIndex != pB->ui32FrameIndex)
+    {
+        return (pA->ui32FrameIndex < pB->ui32FrameIndex) ? -1 : 1;
+    }
+    if (pA->ui64Offset != pB->ui64Offset)
+    {
+        return (pA->ui64Offset < pB->ui64Offset) ? -1 : 1;
+    }
+    return 0;
+}
 
-            }
-            
-            FileSprintf(pArrResultFileName, "\n\n");
+//-----------------------------------------------------------
+/*
+\brief		结束结果缓存：解析成功时写入帧表和payload模块表，重写文件头后改名为正式缓存文件；否则删除临时文件
+\parm   	pCache					结果缓存
+\parm   	pTempFileName			缓存临时文件路径
+\parm   	pCacheFileName			缓存文件路径
+\parm   	bSave					解析成功，保存缓存
+\parm   	ui64ErrorCount			协议错误总数与出错模块数之和
+\return
+*/
+//-----------------------------------------------------------
+void CacheFinish(RESULT_CACHE *pCache, const char *pTempFileName, const char *pCacheFileName, bool bSave, uint64_t ui64ErrorCount)
+{
+    CACHE_HEADER *pHeader = &pCache->stHeader;
+    FILE *fpCache = pCache->fpCache;
+    g_fpTextCache = NULL;
+    if (bSave)
+    {
+        pHeader->ui64TextSize = ftell(fpCache) - sizeof(CACHE_HEADER);
+        pHeader->ui64ErrorCount = ui64ErrorCount;
+        qsort(pCache->pSpan, pHeader->ui32SpanNum, sizeof(CACHE_SPAN), CacheSpanCompare);
+        fwrite(pCache->pFrame, sizeof(CACHE_FRAME), pHeader->ui32FrameNum, fpCache);
+        fwrite(pCache->pSpan, sizeof(CACHE_SPAN), pHeader->ui32SpanNum, fpCache);
+        fseek(fpCache, 0, SEEK_SET);
+        fwrite(pHeader, sizeof(CACHE_HEADER), 1, fpCache);
+        bSave = (ferror(fpCache) == 0);
+    }
+    if (fclose(fpCache) != 0)
+    {
+        bSave = false;
+    }
+    if (!bSave || (rename(pTempFileName, pCacheFileName) != 0))
+    {
+        unlink(pTempFileName);
+    }
+
+    delete [] (char *)pCache->pFrame;
+    pCache->pFrame = NULL;
+    delete [] (char *)pCache->pSpan;
+    pCache->pSpan = NULL;
+    pCache->fpCache = NULL;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		按缓存中的位置重新转换一个payload模块，追加到图像文件和帧缓冲区
+\parm   	fpData					log文件指针
+\parm   	stOffset				各数据段偏移量结构体
+\parm   	pSpan					payload模块位置
+\parm   	fpImage					图像文件，不输出时为NULL
+\parm   	pDevEnpInfo				帧缓冲区所在的设备端口信息，不输出原始帧流时为NULL
+\return		0 成功; -1 读取log失败
+*/
+//-----------------------------------------------------------
+int CacheReplaySpan(FILE *fpData, const LOCATION_OFFSET &stOffset, const CACHE_SPAN *pSpan, FILE *fpImage, DEV_ENP_INFO *pDevEnpInfo)
+{
+    if (fseeko(fpData, pSpan->ui64Offset, SEEK_SET) != 0)
+    {
+        return -1;
+    }
+
+    char arrLine[ROW_LENGTH];
+    char arrPayload[ROW_LENGTH];
+    uint64_t ui64Remain = pSpan->ui64ValidSize;
+    for (uint32_t i = 0; (i < pSpan->ui32LineNum) && (ui64Remain > 0); ++i)
+    {
+        memset(arrLine, 0, ROW_LENGTH*sizeof(char));
+        if (fgets(arrLine, ROW_LENGTH, fpData) == NULL)
+        {
+            return -1;
         }
-        else if (pCMD->m_stCCDCmd.ui16CommandID == U3V_WRITE_MEM_CMD)
+        bool bWrongNum = false;
+        uint64_t ui64Size = GetLineBytes(arrLine, stOffset, arrPayload, ROW_LENGTH, bWrongNum);
+        ui64Size = (ui64Size < ui64Remain) ? ui64Size : ui64Remain;
+        ui64Remain -= ui64Size;
+        if (fpImage != NULL)
         {
-            WRITE_MEM_CMD *pstWriteMemCMD = (WRITE_MEM_CMD *)pCmdPacket;
-            FileSprintf(pArrResultFileName, "#WRITE CMD:  PREFIX:0x%x Flags:0x%x CommandID:0x%x RequestID:0x%x Address:0x%llx", pstWriteMemCMD->m_stPrefix.ui32Prefix
-                                                                                                   , pstWriteMemCMD->m_stCCDCmd.ui16Flag
-                                                                                                   , pstWriteMemCMD->m_stCCDCmd.ui16CommandID
-                                                                                                   , pstWriteMemCMD->m_stCCDCmd.ui16RequestID
-                                                                                                   , pstWriteMemCMD->m_stSCDWriteMemCmd.ui64RegisterAddress);
-            FileSprintf(pArrResultFileName, " SCDData:");
-            uint64_t *pui64Temp = NULL;
-            if (pstWriteMemCMD->m_stCCDCmd.ui16Length - 8 == 8)
+            fwrite(arrPayload, 1, ui64Size, fpImage);
+        }
+        if (pDevEnpInfo != NULL)
+        {
+            FrameBufferAppend(pDevEnpInfo, arrPayload, ui64Size);
+        }
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		键匹配时从结果缓存回放：输出解析文本和统计，按payload模块位置重新生成图像(PGM或PNG)和原始帧流，不再逐模块解析
+\parm   	pCacheFileName			缓存文件路径
+\parm   	stKey					CacheKeyInit生成的缓存文件头
+\parm   	fpData					log文件指针
+\parm   	pArrResultFileName		解析结果文件路径，校验模式下为NULL
+\parm   	stOption				运行选项
+\parm   	ui64ErrorCount			输出协议错误总数与出错模块数之和
+\return		0 已回放; 1 缓存不存在或不匹配; -1 回放失败
+*/
+//-----------------------------------------------------------
+int CacheReplay(const char *pCacheFileName, const CACHE_HEADER &stKey, FILE *fpData, char *pArrResultFileName, const RUN_OPTION &stOption, uint64_t &ui64ErrorCount)
+{
+    FILE *fpCache = fopen(pCacheFileName, "rb");
+    if (fpCache == NULL)
+    {
+        return 1;
+    }
+
+    //键不同或文件不完整时视为未命中，重新解析后覆盖
+    CACHE_HEADER stHeader;
+    struct stat stCacheStat;
+    if ((fread(&stHeader, sizeof(CACHE_HEADER), 1, fpCache) != 1)
+     || (memcmp(&stHeader, &stKey, offsetof(CACHE_HEADER, stOffset)) != 0)
+     || (fstat(fileno(fpCache), &stCacheStat) != 0)
+     || ((uint64_t)stCacheStat.st_size != sizeof(CACHE_HEADER) + stHeader.ui64TextSize
+                                        + (uint64_t)stHeader.ui32FrameNum * sizeof(CACHE_FRAME)
+                                        + (uint64_t)stHeader.ui32SpanNum * sizeof(CACHE_SPAN)))
+    {
+        fclose(fpCache);
+        return 1;
+    }
+    printf("Result cache hit: %s\n", pCacheFileName);
+
+    //解析文本和统计
+    FILE *fpResult = NULL;
+    if (pArrResultFileName != NULL)
+    {
+        fpResult = fopen(pArrResultFileName, "a");
+    }
+    char *pBuffer = new char[CACHE_COPY_SIZE];
+    uint64_t ui64Remain = stHeader.ui64TextSize;
+    while (ui64Remain > 0)
+    {
+        size_t nRead = fread(pBuffer, 1, (ui64Remain < CACHE_COPY_SIZE) ? ui64Remain : CACHE_COPY_SIZE, fpCache);
+        if (nRead == 0)
+        {
+            break;
+        }
+        fwrite(pBuffer, 1, nRead, stdout);
+        if (fpResult != NULL)
+        {
+            fwrite(pBuffer, 1, nRead, fpResult);
+        }
+        ui64Remain -= nRead;
+    }
+    delete [] pBuffer;
+    pBuffer = NULL;
+    if (fpResult != NULL)
+    {
+        fclose(fpResult);
+        fpResult = NULL;
+    }
+    ui64ErrorCount = stHeader.ui64ErrorCount;
+
+    //帧表和payload模块表
+    CACHE_FRAME *pFrame = (CACHE_FRAME *)new char[stHeader.ui32FrameNum * sizeof(CACHE_FRAME) + 1];
+    CACHE_SPAN *pSpan = (CACHE_SPAN *)new char[stHeader.ui32SpanNum * sizeof(CACHE_SPAN) + 1];
+    int nRet = 0;
+    if ((fread(pFrame, sizeof(CACHE_FRAME), stHeader.ui32FrameNum, fpCache) != stHeader.ui32FrameNum)
+     || (fread(pSpan, sizeof(CACHE_SPAN), stHeader.ui32SpanNum, fpCache) != stHeader.ui32SpanNum))
+    {
+        nRet = -1;
+    }
+    fclose(fpCache);
+    fpCache = NULL;
+
+    LOG_CONTEXT stContext;      //只用于RawStreamWriteFrame
+    memset(&stContext, 0, sizeof(LOG_CONTEXT));
+    stContext.nRawFd = stOption.nRawFd;
+    stContext.bRawHeader = stOption.bRawHeader;
+    DEV_ENP_INFO stDevEnpInfo;
+    memset(&stDevEnpInfo, 0, sizeof(DEV_ENP_INFO));
+    uint32_t j = 0;
+    for (uint32_t i = 0; (i < stHeader.ui32FrameNum) && (nRet == 0); ++i)
+    {
+        CACHE_FRAME *pCurFrame = &pFrame[i];
+        bool bPng = pCurFrame->bImage && pCurFrame->bTrailer && (stOption.pPngEncoder != NULL);
+        FILE *fpImage = NULL;
+        if (pCurFrame->bImage)
+        {
+            char *pSlash = strrchr(pCurFrame->arrFileName, '/');
+            if (pSlash != NULL)
             {
-                pui64Temp = (uint64_t *)(pstWriteMemCMD->m_stSCDWriteMemCmd.arrData + 8);
-                FileSprintf(pArrResultFileName, "0x%llx 0x%llx", (*pui64Temp) >> 32, (*pui64Temp) & 0x0000ffff);
+                *pSlash = '\0';
+                if (access(pCurFrame->arrFileName, F_OK) == -1)
+                {
+                    mkdir(pCurFrame->arrFileName, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+                }
+                *pSlash = '/';
             }
-            else if (pstWriteMemCMD->m_stCCDCmd.ui16Length - 8 == 4)
+        }
+        if (pCurFrame->bImage && (stOption.pPngEncoder == NULL))
+        {
+            fpImage = fopen(pCurFrame->arrFileName, "w+");
+            if (fpImage == NULL)
             {
-                pui64Temp = (uint64_t *)(pstWriteMemCMD->m_stSCDWriteMemCmd.arrData + 8);
-                FileSprintf(pArrResultFileName, "0x%llx", (*pui64Temp) & 0x0000ffff);
+                printf("Create image file fail!!!\n");
             }
             else
             {
-                FileSprintf(pArrResultFileName, "0x");
-                for (int i = 0; i < pstWriteMemCMD->m_stCCDCmd.ui16Length - 8; ++i)
-                {
-                    FileSprintf(pArrResultFileName, "%02x", pstWriteMemCMD->m_stSCDWriteMemCmd.arrData[i]);
-                    if (i >= READ_ACK_DATA_MAX)
-                    {
-                        FileSprintf(pArrResultFileName, "......");
-                        break;
-                    }
-                }
+                fprintf(fpImage, "P5\n%u %u\n255\n", pCurFrame->ui32SizeX, pCurFrame->ui32SizeY);
             }
-            FileSprintf(pArrResultFileName, "\n\n");
         }
-        else if (pCMD->m_stCCDCmd.ui16CommandID == U3V_WRITE_MEM_ACK)
+        bool bRaw = pCurFrame->bComplete && (stContext.nRawFd >= 0);
+        stDevEnpInfo.ui64FrameSize = 0;
+        stDevEnpInfo.stDevEnpNum = pCurFrame->stDevEnpNum;
+        stDevEnpInfo.ui32PixelFormat = pCurFrame->ui32PixelFormat;
+        stDevEnpInfo.ui32SizeX = pCurFrame->ui32SizeX;
+        stDevEnpInfo.ui32SizeY = pCurFrame->ui32SizeY;
+        stDevEnpInfo.ui64Timestamp = pCurFrame->ui64Timestamp;
+        for (; (j < stHeader.ui32SpanNum) && (pSpan[j].ui32FrameIndex == i); ++j)
         {
-            WRITE_MEM_ACK *pstWriteMemACK = (WRITE_MEM_ACK *)pCmdPacket;
-            FileSprintf(pArrResultFileName, "#WRITE ACK:  PREFIX:0x%x Status:0x%x CommandID:0x%x RequestID:0x%x SCDLength:0x%x nWriteLength:0x%x\n", pstWriteMemACK->m_stPrefix.ui32Prefix
-                                                                                                   , pstWriteMemACK->m_stCCDAck.ui16StatusCode
-                                                                                                   , pstWriteMemACK->m_stCCDAck.ui16CommandID
-                                                                                                   , pstWriteMemACK->m_stCCDAck.ui16RequestID
-                                                                                                   , pstWriteMemACK->m_stCCDAck.ui16Length
-                                                                                                   , pstWriteMemACK->m_stSCDWriteMemAck.nWriteLength);
-            FileSprintf(pArrResultFileName, "\n");
+            if (CacheReplaySpan(fpData, stHeader.stOffset, &pSpan[j], fpImage, (bRaw || bPng) ? &stDevEnpInfo : NULL) != 0)
+            {
+                nRet = -1;
+                break;
+            }
+        }
+        if (fpImage != NULL)
+        {
+            fclose(fpImage);
+            fpImage = NULL;
+        }
+        if (bRaw && (nRet == 0))
+        {
+            RawStreamWriteFrame(&stContext, &stDevEnpInfo, pCurFrame->ui64BlockID);
+        }
+        if (bPng && (nRet == 0))
+        {
+            PngEncoderSubmit(stOption.pPngEncoder, &stDevEnpInfo, pCurFrame->arrFileName);
+        }
+    }
+    if (nRet != 0)
+    {
+        printf("Result cache replay fail!!!\n");
+    }
+
+    delete [] stDevEnpInfo.pFrameBuffer;
+    delete [] (char *)pFrame;
+    delete [] (char *)pSpan;
+    return nRet;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		比对表键的哈希值
+\parm   	stKey					比对表键
+\return		哈希值
+*/
+//-----------------------------------------------------------
+uint64_t DiffKeyHash(const DIFF_KEY &stKey)
+{
+    uint64_t ui64Hash = FNV_OFFSET_BASIS;
+    ui64Hash = HashBytes(ui64Hash, &stKey.ui8Type, sizeof(stKey.ui8Type));
+    ui64Hash = HashBytes(ui64Hash, &stKey.ui32DeviceOrder, sizeof(stKey.ui32DeviceOrder));
+    ui64Hash = HashBytes(ui64Hash, &stKey.ui16EndpointNum, sizeof(stKey.ui16EndpointNum));
+    ui64Hash = HashBytes(ui64Hash, &stKey.ui16CommandID, sizeof(stKey.ui16CommandID));
+    ui64Hash = HashBytes(ui64Hash, &stKey.ui64Key, sizeof(stKey.ui64Key));
+    ui64Hash = HashBytes(ui64Hash, &stKey.ui32Occurrence, sizeof(stKey.ui32Occurrence));
+    return ui64Hash;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		判断两个比对表键是否相同
+\parm   	stKey1					比对表键
+\parm   	stKey2					比对表键
+\return		true 相同; false 不同
+*/
+//-----------------------------------------------------------
+bool DiffKeyEqual(const DIFF_KEY &stKey1, const DIFF_KEY &stKey2)
+{
+    return (stKey1.ui8Type == stKey2.ui8Type) && (stKey1.ui32DeviceOrder == stKey2.ui32DeviceOrder)
+        && (stKey1.ui16EndpointNum == stKey2.ui16EndpointNum) && (stKey1.ui16CommandID == stKey2.ui16CommandID)
+        && (stKey1.ui64Key == stKey2.ui64Key) && (stKey1.ui32Occurrence == stKey2.ui32Occurrence);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		初始化比对哈希表
+\parm   	pTable					比对哈希表
+\parm   	ui64Capacity			容量(必须为2的幂)
+\return
+*/
+//-----------------------------------------------------------
+void DiffTableInit(DIFF_TABLE *pTable, uint64_t ui64Capacity)
+{
+    pTable->pEntry = new DIFF_ENTRY[ui64Capacity];
+    memset(pTable->pEntry, 0, ui64Capacity*sizeof(DIFF_ENTRY));
+    pTable->ui64Capacity = ui64Capacity;
+    pTable->ui64Size = 0;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		在比对哈希表(开放寻址、线性探测)中查找键，可选择不存在时插入；装载率超过3/4时扩容
+\parm   	pTable					比对哈希表
+\parm   	stKey					查找的键
+\parm   	bInsert					不存在时是否插入
+\return		表项指针，不存在且不插入时返回NULL
+*/
+//-----------------------------------------------------------
+DIFF_ENTRY *DiffTableFind(DIFF_TABLE *pTable, const DIFF_KEY &stKey, bool bInsert)
+{
+    if (bInsert && ((pTable->ui64Size + 1) * 4 > pTable->ui64Capacity * 3))
+    {
+        DIFF_TABLE stOld = *pTable;
+        DiffTableInit(pTable, stOld.ui64Capacity * 2);
+        for (uint64_t i = 0; i < stOld.ui64Capacity; ++i)
+        {
+            if (stOld.pEntry[i].bUsed)
+            {
+                *DiffTableFind(pTable, stOld.pEntry[i].stKey, true) = stOld.pEntry[i];
+            }
+        }
+        delete [] stOld.pEntry;
+    }
+
+    uint64_t ui64Mask = pTable->ui64Capacity - 1;
+    uint64_t ui64Pos = DiffKeyHash(stKey) & ui64Mask;
+    while (pTable->pEntry[ui64Pos].bUsed)
+    {
+        if (DiffKeyEqual(pTable->pEntry[ui64Pos].stKey, stKey))
+        {
+            return &pTable->pEntry[ui64Pos];
+        }
+        ui64Pos = (ui64Pos + 1) & ui64Mask;
+    }
+    if (!bInsert)
+    {
+        return NULL;
+    }
+
+    DIFF_ENTRY *pEntry = &pTable->pEntry[ui64Pos];
+    memset(pEntry, 0, sizeof(DIFF_ENTRY));
+    pEntry->bUsed = true;
+    pEntry->stKey = stKey;
+    pTable->ui64Size++;
+    return pEntry;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		在出现次数计数表(开放寻址、线性探测)中查找键，不存在时插入；装载率超过3/4时扩容
+\parm   	pTable					计数表
+\parm   	stKey					查找的键
+\return		表项指针，扩容后原有指针失效
+*/
+//-----------------------------------------------------------
+DIFF_COUNT *DiffCountGet(DIFF_COUNT_TABLE *pTable, const DIFF_KEY &stKey)
+{
+    if ((pTable->ui64Size + 1) * 4 > pTable->ui64Capacity * 3)
+    {
+        DIFF_COUNT_TABLE stOld = *pTable;
+        uint64_t ui64Capacity = (stOld.ui64Capacity == 0) ? DIFF_TABLE_INIT_SIZE : stOld.ui64Capacity * 2;
+        pTable->pEntry = new DIFF_COUNT[ui64Capacity];
+        memset(pTable->pEntry, 0, ui64Capacity*sizeof(DIFF_COUNT));
+        pTable->ui64Capacity = ui64Capacity;
+        pTable->ui64Size = 0;
+        for (uint64_t i = 0; i < stOld.ui64Capacity; ++i)
+        {
+            if (stOld.pEntry[i].bUsed)
+            {
+                *DiffCountGet(pTable, stOld.pEntry[i].stKey) = stOld.pEntry[i];
+            }
+        }
+        delete [] stOld.pEntry;
+    }
+
+    uint64_t ui64Mask = pTable->ui64Capacity - 1;
+    uint64_t ui64Pos = DiffKeyHash(stKey) & ui64Mask;
+    while (pTable->pEntry[ui64Pos].bUsed)
+    {
+        if (DiffKeyEqual(pTable->pEntry[ui64Pos].stKey, stKey))
+        {
+            return &pTable->pEntry[ui64Pos];
+        }
+        ui64Pos = (ui64Pos + 1) & ui64Mask;
+    }
+
+    DIFF_COUNT *pCount = &pTable->pEntry[ui64Pos];
+    pCount->bUsed = true;
+    pCount->stKey = stKey;
+    pTable->ui64Size++;
+    return pCount;
+}
+
+//-----------------------------------------------------------
+/*
+\brief		删除比对哈希表项，后移探测链上的表项以保持可查找
+\parm   	pTable					比对哈希表
+\parm   	pEntry					要删除的表项
+\return
+*/
+//-----------------------------------------------------------
+void DiffTableErase(DIFF_TABLE *pTable, DIFF_ENTRY *pEntry)
+{
+    uint64_t ui64Mask = pTable->ui64Capacity - 1;
+    uint64_t ui64Hole = pEntry - pTable->pEntry;
+    uint64_t ui64Pos = ui64Hole;
+    pTable->pEntry[ui64Hole].bUsed = false;
+    pTable->ui64Size--;
+    while (true)
+    {
+        ui64Pos = (ui64Pos + 1) & ui64Mask;
+        if (!pTable->pEntry[ui64Pos].bUsed)
+        {
+            break;
+        }
+        //表项理想位置不在(ui64Hole, ui64Pos]区间内时，移入空位
+        uint64_t ui64Home = DiffKeyHash(pTable->pEntry[ui64Pos].stKey) & ui64Mask;
+        if (((ui64Pos - ui64Home) & ui64Mask) >= ((ui64Pos - ui64Hole) & ui64Mask))
+        {
+            pTable->pEntry[ui64Hole] = pTable->pEntry[ui64Pos];
+            pTable->pEntry[ui64Pos].bUsed = false;
+            ui64Hole = ui64Pos;
+        }
+    }
+}
+
+//-----------------------------------------------------------
+/*
+\brief		控制事务命令ID对应的名称
+\parm   	ui16CommandID			命令ID
+\return		命令名称，未知命令ID返回"CMD"
+*/
+//-----------------------------------------------------------
+const char *GetCommandName(uint16_t ui16CommandID)
+{
+    switch (ui16CommandID)
+    {
+    case U3V_READ_MEM_CMD:
+        return "READ CMD";
+    case U3V_READ_MEM_ACK:
+        return "READ ACK";
+    case U3V_WRITE_MEM_CMD:
+        return "WRITE CMD";
+    case U3V_WRITE_MEM_ACK:
+        return "WRITE ACK";
+    case U3V_EVENT_CMD:
+        return "EVENT CMD";
+    default:
+        return "CMD";
+    }
+}
+
+//-----------------------------------------------------------
+/*
+\brief		打印比对记录的标识：类型、设备端口、地址或BlockID及出现次序
+\parm   	stKey					比对表键
+\parm   	pRecordA				log A中的记录，没有时为NULL
+\parm   	pRecordB				log B中的记录，没有时为NULL
+\return
+*/
+//-----------------------------------------------------------
+void DiffPrintRecordName(const DIFF_KEY &stKey, const U3V_RECORD *pRecordA, const U3V_RECORD *pRecordB)
+{
+    const U3V_RECORD *pRecord = (pRecordA != NULL) ? pRecordA : pRecordB;
+    if (stKey.ui8Type == RECORD_FRAME)
+    {
+        printf("Frame(dev#%u", stKey.ui32DeviceOrder);
+    }
+    else
+    {
+        printf("%s(dev#%u", GetCommandName(stKey.ui16CommandID), stKey.ui32DeviceOrder);
+    }
+    //各log中的设备号.端口号@模块序号
+    char arrName[DEV_ENP_NAME_SIZE];
+    const U3V_RECORD *arrRecord[2] = {pRecordA, pRecordB};
+    for (int i = 0; i < 2; ++i)
+    {
+        if (arrRecord[i] == NULL)
+        {
+            printf(" %c:-", 'A' + i);
+        }
+        else
+        {
+            printf(" %c:%s@%llu", 'A' + i, DevEnpName(arrRecord[i]->stDevEnpNum, true, arrName), (unsigned long long)arrRecord[i]->ui64BlockNum);
         }
+    }
+
+    if (stKey.ui8Type == RECORD_FRAME)
+    {
+        printf(") BlockID:0x%llx", (unsigned long long)pRecord->ui64Key);
+    }
+    else if (stKey.ui16CommandID == U3V_EVENT_CMD)
+    {
+        printf(") EventID:0x%llx", (unsigned long long)pRecord->ui64Key);
+    }
+    else if (pRecord->ui64Key == UINT64_MAX)
+    {
+        printf(") Address:unknown");
+    }
+    else
+    {
+        printf(") Address:0x%llx", (unsigned long long)pRecord->ui64Key);
+    }
+    printf(" #%u:", stKey.ui32Occurrence);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		比较两个log中对应的记录，只打印不一致的字段
+\return		true 一致; false 不一致
+*/
+//-----------------------------------------------------------
+bool DiffCompareRecord(const DIFF_KEY &stKey, const U3V_RECORD &stRecordA, const U3V_RECORD &stRecordB)
+{
+    if ((stRecordA.ui16Status == stRecordB.ui16Status) && (stRecordA.ui64Length == stRecordB.ui64Length)
+        && (stRecordA.ui64Hash == stRecordB.ui64Hash) && (stRecordA.ui32PixelFormat == stRecordB.ui32PixelFormat)
+        && (stRecordA.ui32SizeX == stRecordB.ui32SizeX) && (stRecordA.ui32SizeY == stRecordB.ui32SizeY))
+    {
+        return true;
+    }
 
+    printf("#Differ ");
+    DiffPrintRecordName(stKey, &stRecordA, &stRecordB);
+    if (stRecordA.ui16Status != stRecordB.ui16Status)
+    {
+        printf(" Status:0x%x->0x%x", stRecordA.ui16Status, stRecordB.ui16Status);
+    }
+    if (stRecordA.ui64Length != stRecordB.ui64Length)
+    {
+        printf(" Length:0x%llx->0x%llx", (unsigned long long)stRecordA.ui64Length, (unsigned long long)stRecordB.ui64Length);
     }
-   
-    delete pCmdPacket;
-    pCmdPacket = NULL;
-    return 0;
+    if (stRecordA.ui64Hash != stRecordB.ui64Hash)
+    {
+        printf(" Hash:%016llx->%016llx", (unsigned long long)stRecordA.ui64Hash, (unsigned long long)stRecordB.ui64Hash);
+    }
+    if (stRecordA.ui32PixelFormat != stRecordB.ui32PixelFormat)
+    {
+        printf(" PixelFormat:0x%x->0x%x", stRecordA.ui32PixelFormat, stRecordB.ui32PixelFormat);
+    }
+    if ((stRecordA.ui32SizeX != stRecordB.ui32SizeX) || (stRecordA.ui32SizeY != stRecordB.ui32SizeY))
+    {
+        printf(" Size:%ux%u->%ux%u", stRecordA.ui32SizeX, stRecordA.ui32SizeY, stRecordB.ui32SizeX, stRecordB.ui32SizeY);
+    }
+    printf("\n");
+    return false;
 }
 
 //-----------------------------------------------------------
 /*
-\brief  单模块解析
-\parm   pArrStr[][ROW_LENGTH]        单独一个模块的数据
-\parm   index                       模块的行数
-\parm   stOffset                      各数据段偏移量结构体
+\brief		比对模式的事务记录回调：按(设备, 命令ID, 地址)或(设备, 端口, BlockID)及出现次序在另一log的
+\           待匹配表中查找对应记录，找到则比较后删除，否则留在本log的待匹配表中
+\parm   	pUser					DIFF_SIDE指针
+\parm   	stRecord				事务记录
 \return
 */
 //-----------------------------------------------------------
-int ModuleAnalysis(char **pArrStr, int nIndex, DEV_ENP_STATUS (*pArrDevEnpInfo)[MAX_ENDPOINT_NUM], const LOCATION_OFFSET &stOffset, char *pArrResultFileName)
+void DiffRecordSink(void *pUser, const U3V_RECORD &stRecord)
 {
-    char arrFileName[FILENAME_SIZE];
-    DEV_ENP_NUM stDevEnpNum = {0, 0};
-    int nRet = GetDevEnpNum(pArrStr[0], stDevEnpNum);
-    if (nRet != 0)
+    DIFF_SIDE *pSide = (DIFF_SIDE *)pUser;
+    DIFF_SIDE *pOther = pSide->pOther;
+
+    DIFF_KEY stKey;
+    memset(&stKey, 0, sizeof(DIFF_KEY));
+    stKey.ui8Type = stRecord.ui8Type;
+    stKey.ui32DeviceOrder = stRecord.ui32DeviceIndex;  //设备号可能因重新枚举而变化，按设备在log中出现的先后对齐
+    stKey.ui16CommandID = stRecord.ui16CommandID;
+    stKey.ui64Key = stRecord.ui64Key;
+    if (stRecord.ui8Type == RECORD_FRAME)
     {
-        printf("Error GetDevEnpNum\n");
-        return -1;
+        //BlockID在端口内递增，不必逐帧计数；只按端口记录BlockID回退(设备重启)的次数区分重复的BlockID
+        stKey.ui16EndpointNum = stRecord.stDevEnpNum.ui16EndpointNum;
+        DIFF_KEY stCountKey = stKey;
+        stCountKey.ui64Key = 0;
+        DIFF_COUNT *pCount = DiffCountGet(&pSide->stCountTable, stCountKey);
+        if ((pCount->ui64LastBlockID != 0) && (stRecord.ui64Key < pCount->ui64LastBlockID))
+        {
+            pCount->ui32Count++;
+        }
+        pCount->ui64LastBlockID = stRecord.ui64Key + 1;
+        stKey.ui32Occurrence = pCount->ui32Count;
+    }
+    else
+    {
+        stKey.ui32Occurrence = DiffCountGet(&pSide->stCountTable, stKey)->ui32Count++;
     }
+    pSide->ui64RecordNum++;
 
-    char arrPhase[20];
-    memcpy(arrPhase, pArrStr[0] + stOffset.ui16PhaseOff, stOffset.ui16PhaseLength);
-    arrPhase[stOffset.ui16PhaseLength] = '\0';
+    DIFF_ENTRY *pEntry = DiffTableFind(&pOther->stPendingTable, stKey, false);
+    if (pEntry == NULL)
+    {
+        DiffTableFind(&pSide->stPendingTable, stKey, true)->stRecord = stRecord;
+        return;
+    }
+
+    bool bSame = (pSide->nIndex == 0) ? DiffCompareRecord(stKey, stRecord, pEntry->stRecord)
+                                      : DiffCompareRecord(stKey, pEntry->stRecord, stRecord);
+    (*pSide->pMatchNum)++;
+    if (!bSame)
+    {
+        (*pSide->pDifferNum)++;
+    }
+    DiffTableErase(&pOther->stPendingTable, pEntry);
+}
+
+//-----------------------------------------------------------
+/*
+\brief		比较待匹配表项在log中的位置，用于按log顺序输出
+\parm   	pEntry1					DIFF_ENTRY指针元素
+\parm   	pEntry2					DIFF_ENTRY指针元素
+\return		<0 pEntry1在前; 0 相同; >0 pEntry2在前
+*/
+//-----------------------------------------------------------
+int DiffEntryCompare(const void *pEntry1, const void *pEntry2)
+{
+    uint64_t ui64Block1 = (*(const DIFF_ENTRY **)pEntry1)->stRecord.ui64BlockNum;
+    uint64_t ui64Block2 = (*(const DIFF_ENTRY **)pEntry2)->stRecord.ui64BlockNum;
+    return (ui64Block1 < ui64Block2) ? -1 : ((ui64Block1 > ui64Block2) ? 1 : 0);
+}
 
-    if (pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui8Status == 0)  //U3VC
+//-----------------------------------------------------------
+/*
+\brief		按log顺序输出只在一个log中出现的记录
+\parm   	pSide					比对的一侧
+\return		记录数
+*/
+//-----------------------------------------------------------
+uint64_t DiffReportUnmatched(DIFF_SIDE *pSide)
+{
+    uint64_t ui64Num = 0;
+    DIFF_ENTRY **pArrEntry = new DIFF_ENTRY*[pSide->stPendingTable.ui64Size + 1];
+    for (uint64_t i = 0; i < pSide->stPendingTable.ui64Capacity; ++i)
     {
-        if (strstr(pArrStr[0], "55 33 56 43") != NULL)
+        if (pSide->stPendingTable.pEntry[i].bUsed)
         {
-            CodeToCMD(pArrStr, nIndex, stOffset, pArrResultFileName);
+            pArrEntry[ui64Num++] = &pSide->stPendingTable.pEntry[i];
         }
-        else if (strstr(pArrStr[0], "55 33 56 4c") != NULL)
-        {
-            //打印Leader信息
-            char *pCmdPacket = new char[nIndex*ROW_LENGTH];
-            GetPacket(pArrStr, nIndex, stOffset, pCmdPacket);
-            IMAGE_LEADER *pImageLeader = new IMAGE_LEADER;
-            pImageLeader = (IMAGE_LEADER *)pCmdPacket;
-            FileSprintf(pArrResultFileName, "#ImageLeader(%d.%d): BlockID:0x%llx PayloadType:0x%x Timestamp:0x%llx PixelFormat:0x%x SizeX:0x%x SizeY:0x%x OffsetX:0x%x OffsetY:0x%x\n\n"
-            																						, stDevEnpNum.ui8DeviceNum
-            																						, stDevEnpNum.ui8EndpointNum
-            																						, pImageLeader->ui64BlockID
-                                                                                                    , pImageLeader->ui16PayloadType
-                                                                                                    , pImageLeader->ui64Timestamp
-                                                                                                    , pImageLeader->ui32PixelFormat
-                                                                                                    , pImageLeader->ui32SizeX
-                                                                                                    , pImageLeader->ui32SizeY
-                                                                                                    , pImageLeader->ui32OffsetX
-                                                                                                    , pImageLeader->ui32OffsetY);
-
-            pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui8Status = 1;   //U3VL ImageLeader
-            pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui64BlockID = pImageLeader->ui64BlockID;  //保存ImageLeader中的BlockID
-            pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui64PayloadSizeSum = 0; //将payload size总和清零
-
-            //创建文件夹和图像文件
-            memset(arrFileName, 0, FILENAME_SIZE);
-            sprintf(arrFileName, "./%03d", stDevEnpNum.ui8DeviceNum);
-            if (access(arrFileName, F_OK) == -1)
-            {
-                mkdir(arrFileName, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
-            }
-
-            char arrTime[30] = {0};
-            memcpy(arrTime, pArrStr[0] + stOffset.ui16TimeOff, stOffset.ui16TimeLength);
-            arrTime[stOffset.ui16TimeLength] = '\0';
-            char *pTimeMs = strstr(arrTime, ".");
-            if (pTimeMs == NULL)
-            {
-                printf("Not find ms\n");
-                return -1;
-            }
-            uint16_t ui16TimeMs = strtol(pTimeMs + 1, NULL, 10);
-            sprintf(arrFileName, "./%03d/%03d_%03lld_%03d.pgm", stDevEnpNum.ui8DeviceNum, stDevEnpNum.ui8DeviceNum, pImageLeader->ui64BlockID, ui16TimeMs);
-            strcpy(pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].arrCurrentFileName, arrFileName);
-            FILE *fpImage = fopen(arrFileName, "w+");
-            if (fpImage == NULL)
-            {
-                printf("Create image file fail!!!\n");
-                return -1;
-            }
-            fprintf(fpImage, "P5\n%u %u\n255\n", pImageLeader->ui32SizeX, pImageLeader->ui32SizeY);
-            fclose(fpImage);
-            fpImage = NULL;
+    }
+    qsort(pArrEntry, ui64Num, sizeof(DIFF_ENTRY *), DiffEntryCompare);
+    for (uint64_t i = 0; i < ui64Num; ++i)
+    {
+        printf("#OnlyIn%c ", (pSide->nIndex == 0) ? 'A' : 'B');
+        DiffPrintRecordName(pArrEntry[i]->stKey, (pSide->nIndex == 0) ? &pArrEntry[i]->stRecord : NULL
+                                               , (pSide->nIndex == 0) ? NULL : &pArrEntry[i]->stRecord);
+        printf(" Length:0x%llx Status:0x%x Hash:%016llx\n", (unsigned long long)pArrEntry[i]->stRecord.ui64Length
+                                                          , pArrEntry[i]->stRecord.ui16Status
+                                                          , (unsigned long long)pArrEntry[i]->stRecord.ui64Hash);
+    }
+    delete [] pArrEntry;
+    return ui64Num;
+}
 
-            delete pCmdPacket;
-            pCmdPacket = NULL;
+//-----------------------------------------------------------
+/*
+\brief		同时流式读取两个log，对齐控制事务和图像帧并只输出不一致之处，不写解析文本和图像文件
+\parm   	arrLogFileName			两个log文件路径
+\parm   	pArrStr					两个log各自存储单个模块数据的二维数组
+\parm   	ui64DifferCount			输出不一致记录总数
+\return		0 成功; -1 log打开或解析失败
+*/
+//-----------------------------------------------------------
+int DiffAnalysis(const char *arrLogFileName[2], char **pArrStr[2], uint64_t &ui64DifferCount)
+{
+    DIFF_SIDE arrSide[2];
+    uint64_t ui64MatchNum = 0;
+    uint64_t ui64DifferNum = 0;
+    int nRet = 0;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        DIFF_SIDE *pSide = &arrSide[i];
+        pSide->nIndex = i;
+        pSide->pOther = &arrSide[1 - i];
+        pSide->pMatchNum = &ui64MatchNum;
+        pSide->pDifferNum = &ui64DifferNum;
+        pSide->ui64RecordNum = 0;
+        pSide->pArrStr = pArrStr[i];
+        memset(&pSide->stCountTable, 0, sizeof(DIFF_COUNT_TABLE));
+        DiffTableInit(&pSide->stPendingTable, DIFF_TABLE_INIT_SIZE);
+
+        LogContextInit(&pSide->stContext, NULL);
+        pSide->stContext.bTextOutput = false;
+        pSide->stContext.bErrorOutput = false;
+        pSide->stContext.bImageOutput = false;
+        pSide->stContext.pfnRecordSink = DiffRecordSink;
+        pSide->stContext.pSinkUser = pSide;
+        pSide->stContext.pReader = &pSide->stReader;
+
+        pSide->fpData = fopen(arrLogFileName[i], "r");
+        if (pSide->fpData == NULL)
+        {
+            printf("File Open Fail: %s\n", arrLogFileName[i]);
+            nRet = -1;
+            continue;
         }
-        else if(strstr(arrPhase, "IN") != NULL)
+        setvbuf(pSide->fpData, NULL, _IOFBF, INPUT_BUFFER_SIZE);
+        if (LogReaderOpen(&pSide->stReader, pSide->fpData, pSide->stContext.stOffset) != 0)
         {
-            FileSprintf(pArrResultFileName, "有残帧!!!\n");
-            return -1;
+            nRet = -1;
         }
     }
-    else if (pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui8Status == 1)
+
+    //两个log交替各读取一个模块，待匹配表只保存两者进度差内的记录
+    bool arrEnd[2] = {nRet != 0, nRet != 0};
+    while (!arrEnd[0] || !arrEnd[1])
     {
-        if (strstr(pArrStr[0], "55 33 56") != NULL)
+        for (int i = 0; i < 2; ++i)
         {
-            FileSprintf(pArrResultFileName, "没有payload\n");
-            return -1;
-        } 
+            if (arrEnd[i])
+            {
+                continue;
+            }
+            int nIndex = 0;
+            int nStatus = LogReaderNext(&arrSide[i].stReader, arrSide[i].stContext.stOffset, arrSide[i].pArrStr, nIndex, &arrSide[i].stContext.stBlockHead);
+            if (nStatus != 0)
+            {
+                arrEnd[i] = true;
+                nRet = (nStatus < 0) ? -1 : nRet;
+                continue;
+            }
+            arrSide[i].stContext.ui64BlockNum++;
+            ModuleAnalysis(arrSide[i].pArrStr, nIndex, &arrSide[i].stContext);
+        }
+    }
 
-        pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui64PayloadSizeSum += WriteByteToImg(pArrStr, nIndex, pArrDevEnpInfo, stOffset, stDevEnpNum);
-        pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui8Status = 2;     //下一个模块属于payload  
+    uint64_t ui64OnlyA = 0;
+    uint64_t ui64OnlyB = 0;
+    if (nRet == 0)
+    {
+        ui64OnlyA = DiffReportUnmatched(&arrSide[0]);
+        ui64OnlyB = DiffReportUnmatched(&arrSide[1]);
+        printf("#Diff: RecordsA:%llu RecordsB:%llu Matched:%llu Differ:%llu OnlyInA:%llu OnlyInB:%llu\n", (unsigned long long)arrSide[0].ui64RecordNum
+                                                                                                        , (unsigned long long)arrSide[1].ui64RecordNum
+                                                                                                        , (unsigned long long)ui64MatchNum
+                                                                                                        , (unsigned long long)ui64DifferNum
+                                                                                                        , (unsigned long long)ui64OnlyA
+                                                                                                        , (unsigned long long)ui64OnlyB);
     }
-    else if (pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui8Status == 2)  //图像数据payload模块
+    ui64DifferCount = ui64DifferNum + ui64OnlyA + ui64OnlyB;
+
+    for (int i = 0; i < 2; ++i)
     {
-        if (strstr(pArrStr[0], "55 33 56 54") != NULL)  //U3VT ImageTrailor
-        {
-            ///打印Trailor信息
-            char *pCmdPacket = new char[nIndex*ROW_LENGTH];
-            GetPacket(pArrStr, nIndex, stOffset, pCmdPacket);
-            IMAGE_TRAILER *pImageTrailer = new IMAGE_TRAILER;
-            pImageTrailer = (IMAGE_TRAILER *)pCmdPacket;
-            FileSprintf(pArrResultFileName, "#ImageTrailor(%d.%d): TrailerSize:0x%x BlockID:0x%llx Status:0x%x ValidPayloadSize:0x%llx SizeY:0x%x\n\n"
-            																						, stDevEnpNum.ui8DeviceNum
-            																						, stDevEnpNum.ui8EndpointNum
-            																						, pImageTrailer->ui16TrailerSize
-                                                                                                    , pImageTrailer->ui64BlockID
-                                                                                                    , pImageTrailer->ui16Status
-                                                                                                    , pImageTrailer->ui64ValidPayloadSize
-                                                                                                    , pImageTrailer->ui32SizeY);
-
-            pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui8Status = 0;
-            if (pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui64BlockID != pImageTrailer->ui64BlockID) //判断Leader和Trailor的BlockID是否匹配
-            {
-            	FileSprintf(pArrResultFileName, "Leader和Trailor BlockID不匹配!!!\n");
-            	delete pCmdPacket;
-            	pCmdPacket = NULL;
-            	return -1;	
-            }
-            if (pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui64PayloadSizeSum != pImageTrailer->ui64ValidPayloadSize)
-            {
-            	FileSprintf(pArrResultFileName, "payload数据总大小不等于Trailor中的payload size!!!\n");
-            	delete pCmdPacket;
-            	pCmdPacket = NULL;
-            	return -1;
-            }
-            delete pCmdPacket;
-            pCmdPacket = NULL;
-        }   
-        else if(strstr(pArrStr[0], "55 33 56") != NULL)  //没有来Trailor
+        if (arrSide[i].fpData != NULL)
         {
-            FileSprintf(pArrResultFileName, "没有Trailor，有残帧!!!\n");
-            return -1;
-        }
-        else  //payload数据
-        {
-        	//payload写入文件，并计算payload累加和
-        	pArrDevEnpInfo[stDevEnpNum.ui8DeviceNum][stDevEnpNum.ui8EndpointNum].ui64PayloadSizeSum += WriteByteToImg(pArrStr, nIndex, pArrDevEnpInfo, stOffset, stDevEnpNum);
+            fclose(arrSide[i].fpData);
+            arrSide[i].fpData = NULL;
         }
+        LogContextRelease(&arrSide[i].stContext);
+        delete [] arrSide[i].stCountTable.pEntry;
+        delete [] arrSide[i].stPendingTable.pEntry;
     }
-    return 0;
-
+    return nRet;
 }
 
 //-----------------------------------------------------------
 /*
-\brief  从原始数据中，提取出模块数据，并调用ModuleAnalysis函数解析
-\parm   fpData                      文件指针
-\parm  	pArrStr  					存储单个模块数据的二维数组
-\return
+\brief		解析字节数参数，可带K、M、G后缀(1024进制)
+\parm   	pArg					参数字符串
+\return		字节数
 */
 //-----------------------------------------------------------
-int LogAnalysis(FILE *fpData, char **pArrStr, char *pArrResultFileName)
+uint64_t ParseByteSize(const char *pArg)
 {
-    //char pArrStr[CMD_LINE_NUM][ROW_LENGTH];
-    char arrTemp[ROW_LENGTH];   //存放一行数据
-    char *pTemp = NULL;
-    char *pStatus = NULL;
-    bool bStatus = false;
-    LOCATION_OFFSET stOffset;
-    int nIndex = 0;
-    char arrCmdPhase[ARR_CMD_PHASE_LENGTH];
-    int nOverFlow = 0;
-
-    //设备端口号功能注册二维数组
-    DEV_ENP_STATUS arrDevEnpInfo[MAX_DEVICE_NUM][MAX_ENDPOINT_NUM];
-    memset(arrDevEnpInfo, 0, MAX_DEVICE_NUM*MAX_ENDPOINT_NUM*sizeof(DEV_ENP_STATUS));
-    
-    memset(arrTemp, 0, ROW_LENGTH*sizeof(char));
-    
-    while(!bStatus)
+    char *pEnd = NULL;
+    uint64_t ui64Size = strtoull(pArg, &pEnd, 10);
+    switch (*pEnd)
     {
-        pStatus = fgets(arrTemp, ROW_LENGTH, fpData);
-        if (pStatus == NULL)
-        {
-            printf("Not find Description or Device or Data or Time!\n");
-            return -1;
-        }   
-        bStatus = ((strstr(arrTemp, "Description") != NULL) && (strstr(arrTemp, "Device") != NULL)\
-                                                            && (strstr(arrTemp, "Data") != NULL)\
-                                                            && (strstr(arrTemp, "Time") != NULL));
+        case 'G': case 'g':
+            ui64Size <<= 30;
+            break;
+        case 'M': case 'm':
+            ui64Size <<= 20;
+            break;
+        case 'K': case 'k':
+            ui64Size <<= 10;
+            break;
+        default:
+            break;
     }
-    FileSprintf(pArrResultFileName, "%s", arrTemp);
-
-    stOffset.ui16PhaseOff = strstr(arrTemp, "Phase") - strstr(arrTemp, "Device");
-    stOffset.ui16DataOff = strstr(arrTemp, "Data") - strstr(arrTemp, "Device");
-    stOffset.ui16DescriptOff = strstr(arrTemp, "Description") - strstr(arrTemp, "Device");
-    stOffset.ui16CmdPhaseOff = strstr(arrTemp, "Cmd.Phase.Ofs(rep)") - strstr(arrTemp, "Device");
-    stOffset.ui16TimeOff = strstr(arrTemp, "Time") - strstr(arrTemp, "Device");
-    stOffset.ui16LenOff = strstr(arrTemp, "Length") - strstr(arrTemp, "Device");
-
+    return ui64Size;
+}
 
-    pStatus = fgets(arrTemp, ROW_LENGTH, fpData);
-    if (pStatus == NULL)
+//-----------------------------------------------------------
+/*
+\brief		创建动态二维数组，保存单个模块数据
+\return		CMD_LINE_NUM行、每行ROW_LENGTH字节的二维数组
+*/
+//-----------------------------------------------------------
+char **AllocModuleBuffer()
+{
+    char **pArrStr = new char*[CMD_LINE_NUM];
+    for (int i = 0; i < CMD_LINE_NUM; ++i)
     {
-        printf("Read no data!\n");
-        return -1;
+        pArrStr[i] = new char[ROW_LENGTH];
     }
-    FileSprintf(pArrResultFileName, "%s", arrTemp);
-
-    stOffset.ui16DataLength = CalSegLength(arrTemp + stOffset.ui16DataOff);
-    stOffset.ui16PhaseLength = CalSegLength(arrTemp + stOffset.ui16PhaseOff);
-    stOffset.ui16CmdPhaseLength = CalSegLength(arrTemp + stOffset.ui16CmdPhaseOff);
-    stOffset.ui16TimeLength = CalSegLength(arrTemp + stOffset.ui16TimeOff);
-    stOffset.ui16LenLength = CalSegLength(arrTemp + stOffset.ui16LenOff);
+    return pArrStr;
+}
 
+//-----------------------------------------------------------
+/*
+\brief		删除AllocModuleBuffer创建的二维数组
+\parm   	pArrStr					AllocModuleBuffer返回的二维数组
+\return		无
+*/
+//-----------------------------------------------------------
+void FreeModuleBuffer(char **pArrStr)
+{
+    for (int i = 0; i < CMD_LINE_NUM; ++i)
+    {
+        delete [] pArrStr[i];        
+    }
+    delete [] pArrStr;
+}
 
-    //根据CmdPhase特征提取各个单独数据模块
-    while(pTemp == NULL)
+int main(int argc, char const *argv[])
+{
+    RUN_OPTION stOption;
+    memset(&stOption, 0, sizeof(RUN_OPTION));
+    stOption.ui32TopNum = PROFILE_TOP_NUM;
+    stOption.nRawFd = -1;
+    stOption.nPngLevel = PNG_DEFAULT_LEVEL;
+    const char *arrLogFileName[2] = {NULL, NULL};
+    int nLogFileNum = 0;
+    for (int i = 1; i < argc; ++i)
     {
-        pStatus = fgets(arrTemp, ROW_LENGTH, fpData);
-        if (pStatus == NULL)
+        if (strcmp(argv[i], "--validate") == 0)
         {
-            printf("Not find data\n");
-            return -1;
+            stOption.bValidate = true;
+        }
+        else if (strcmp(argv[i], "--diff") == 0)
+        {
+            stOption.bDiff = true;
+        }
+        else if (strcmp(argv[i], "--profile") == 0)
+        {
+            stOption.bProfile = true;
+        }
+        else if ((strcmp(argv[i], "--top") == 0) && (i + 1 < argc))
+        {
+            stOption.ui32TopNum = strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--raw-stream") == 0) && (i + 1 < argc))
+        {
+            stOption.pRawStreamPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--raw-header") == 0)
+        {
+            stOption.bRawHeader = true;
+        }
+        else if ((strcmp(argv[i], "--frames-per-stream") == 0) && (i + 1 < argc))
+        {
+            stOption.ui32FramesPerStream = strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--every-nth-frame") == 0) && (i + 1 < argc))
+        {
+            stOption.ui32EveryNthFrame = strtoul(argv[++i], NULL, 10);
+        }
+        else if ((strcmp(argv[i], "--max-bytes") == 0) && (i + 1 < argc))
+        {
+            stOption.ui64MaxBytes = ParseByteSize(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cache") == 0)
+        {
+            stOption.bCache = true;
+        }
+        else if (strcmp(argv[i], "--png") == 0)
+        {
+            stOption.bPng = true;
+        }
+        else if ((strcmp(argv[i], "--png-level") == 0) && (i + 1 < argc))
+        {
+            stOption.nPngLevel = strtol(argv[++i], NULL, 10);
+        }
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            printf("Unknown Option: %s\n", argv[i]);
+            return 0;
+        }
+        else if (nLogFileNum < 2)
+        {
+            arrLogFileName[nLogFileNum++] = argv[i];
         }
-        memset(arrCmdPhase, 0, ARR_CMD_PHASE_LENGTH);
-        memcpy(arrCmdPhase, arrTemp + stOffset.ui16CmdPhaseOff, stOffset.ui16CmdPhaseLength);
-        arrCmdPhase[stOffset.ui16CmdPhaseLength] = '\0';
-        pTemp = strstr(arrCmdPhase, ".");
     }
 
-    uint16_t ui16CmdPhaseOff = pTemp - arrCmdPhase;
-    char arrCMP1[ARR_CMD_PHASE_LENGTH];
-    char arrCMP2[ARR_CMD_PHASE_LENGTH];
-    
-    memset(arrCMP1, 0, ARR_CMD_PHASE_LENGTH);
-    memset(arrCMP2, 0, ARR_CMD_PHASE_LENGTH);
-    memcpy(arrCMP1, arrTemp + stOffset.ui16CmdPhaseOff, ui16CmdPhaseOff);
-    arrCMP1[ui16CmdPhaseOff] = '\0';
+    if (stOption.bDiff)
+    {
+        if (nLogFileNum != 2)
+        {
+            printf("Missing Parm Error: \nPlease Input as \"./logAnalysis --diff A.txt B.txt\"\n");
+            return 0;
+        }
+        char **arrModuleBuffer[2] = {AllocModuleBuffer(), AllocModuleBuffer()};
+        uint64_t ui64DifferCount = 0;
+        int nStatus = DiffAnalysis(arrLogFileName, arrModuleBuffer, ui64DifferCount);
+        FreeModuleBuffer(arrModuleBuffer[0]);
+        FreeModuleBuffer(arrModuleBuffer[1]);
+        return ((nStatus != 0) || (ui64DifferCount != 0)) ? 1 : 0;
+    }
 
-    uint16_t ui16LoopOverFlow = 0;
-    //结束条件有两个：1 读取文件末尾； 2 模块数超过LOG_BLOCK_NUM则退出解析;
-    while ((pStatus != NULL) && (ui16LoopOverFlow < LOG_BLOCK_NUM))
-    {
-        int nflagCmdPhase = 0;
-        //条件1:CmdPhase比较是否为一个命令块; 条件2:一个模块超过MODULE_LINE_MAX行，则认为是图像数据，后续不进行命令解析
-        while(nflagCmdPhase == 0) 
-        {
-        	if (nIndex > CMD_LINE_NUM)
-        	{
-        		printf("Beyond CMD_LINE_NUM Rows !!!\n");
-        		return -1;
-        	}
-            memcpy(pArrStr[nIndex++], arrTemp, ROW_LENGTH); 
-            memset(arrTemp, 0, ROW_LENGTH*sizeof(char));
-            pStatus = fgets(arrTemp, ROW_LENGTH, fpData);
-            if (pStatus == NULL)
-            {
-                break;
-            }
-            memcpy(arrCMP2, arrTemp + stOffset.ui16CmdPhaseOff, ui16CmdPhaseOff);
-            arrCMP2[ui16CmdPhaseOff] = '\0';
-            nflagCmdPhase = strcmp(arrCMP1, arrCMP2);
+    const char *pLogFileName = arrLogFileName[0];
+	if (pLogFileName == NULL)
+	{
+		printf("Missing Parm Error: \nPlease Input as \"./logAnalysis [--validate] [--profile [--top N]] [--raw-stream PATH|- [--raw-header]] [--frames-per-stream N] [--every-nth-frame K] [--max-bytes SIZE[K|M|G]] [--png [--png-level 0-9]] [--cache] *.txt\" or \"./logAnalysis --diff A.txt B.txt\"\n");
+		return 0;
+	}
+    if (stOption.pRawStreamPath != NULL)
+    {
+        if (stOption.bValidate || stOption.bProfile)
+        {
+            printf("--raw-stream can not be used with --validate or --profile\n");
+            return 0;
         }
-        strcpy(arrCMP1, arrCMP2);
-        if (strstr(pArrStr[0], "55 33 56") == NULL)
+        signal(SIGPIPE, SIG_IGN);   //下游退出时由write返回错误，不终止解析
+        if (strcmp(stOption.pRawStreamPath, "-") == 0)
         {
-            FileSprintf(pArrResultFileName, "%s", pArrStr[0]);
+            //标准输出只传输帧数据，控制台文本改为输出到标准错误
+            stOption.nRawFd = dup(STDOUT_FILENO);
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+            setvbuf(stdout, NULL, _IOLBF, 0);
         }
         else
         {
-            for (int i = 0; i < nIndex; ++i)
-            {
-                FileSprintf(pArrResultFileName, "%s", pArrStr[i]);
-            }
+            stOption.nRawFd = open(stOption.pRawStreamPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        if (stOption.nRawFd < 0)
+        {
+            printf("Open raw stream fail!!!\n");
+            return 0;
         }
-        
-        ModuleAnalysis(pArrStr, nIndex, arrDevEnpInfo, stOffset, pArrResultFileName);
-        nIndex = 0;
-        ui16LoopOverFlow++;
     }
 
-    return 0;
-}   
+    PNG_ENCODER stPngEncoder;
+    if (stOption.bPng)
+    {
+        if (stOption.bValidate || stOption.bProfile || (stOption.pRawStreamPath != NULL))
+        {
+            printf("--png can not be used with --validate, --profile or --raw-stream\n");
+            return 0;
+        }
+        if ((stOption.nPngLevel < 0) || (stOption.nPngLevel > 9))
+        {
+            printf("--png-level must be 0~9\n");
+            return 0;
+        }
+        if (PngEncoderInit(&stPngEncoder, stOption.nPngLevel) != 0)
+        {
+            printf("Create png encoder fail!!!\n");
+            return 0;
+        }
+        stOption.pPngEncoder = &stPngEncoder;
+    }
 
-int main(int argc, char const *argv[])
-{
-	if (argv[1] == NULL)
-	{
-		printf("Missing Parm Error: \nPlease Input as \"./logAnalysis *.txt\"\n");
-		return 0;
-	}
-    FILE *fpData = fopen(argv[1], "r");  //只读打开文件
+    FILE *fpData = fopen(pLogFileName, "r");  //只读打开文件
     if (fpData == NULL)
     {
         printf("File Open Fail !!!");
-        fclose(fpData);
-        fpData = NULL;
         return 0;
     }
+    setvbuf(fpData, NULL, _IOFBF, INPUT_BUFFER_SIZE);
 
     //创建动态二维数组，保存图像数据
-    char **pArrStr = new char*[CMD_LINE_NUM];
-    for (int i = 0; i < CMD_LINE_NUM; ++i)
-    {
-        pArrStr[i] = new char[ROW_LENGTH];
-    }
+    char **pArrStr = AllocModuleBuffer();
 
     //创建解析结果保存文件
     char arrResultFileName[FILENAME_SIZE];
     char arrNameTemp[FILENAME_SIZE];
-    strcpy(arrNameTemp, argv[1]);
-    arrNameTemp[strlen(argv[1])] = '\0';
+    strcpy(arrNameTemp, pLogFileName);
+    arrNameTemp[strlen(pLogFileName)] = '\0';
     char *pDot = strstr(arrNameTemp, ".");
     if (pDot == NULL)
     {
@@ -707,30 +4216,77 @@ int main(int argc, char const *argv[])
     }
     *pDot = '\0';
     sprintf(arrResultFileName, "./%s_result.txt", arrNameTemp);
-    FILE *fpResult = fopen(arrResultFileName, "w+");
-    if (fpResult == NULL)
+    char *pArrResultFileName = NULL;      //校验和寄存器统计模式不创建解析结果文件
+    if (!stOption.bValidate && !stOption.bProfile)
     {
-        printf("Create result file fail!!!\n");
-        return 0;
+        FILE *fpResult = fopen(arrResultFileName, "w+");
+        if (fpResult == NULL)
+        {
+            printf("Create result file fail!!!\n");
+            return 0;
+        }
+        fclose(fpResult);
+        fpResult = NULL;
+        pArrResultFileName = arrResultFileName;
     }
-    fclose(fpResult);
-    fpResult = NULL;
 
-    int status = LogAnalysis(fpData, pArrStr, arrResultFileName);
+    //结果缓存文件名不含"_result"，不会被make clean删除
+    char arrCacheFileName[FILENAME_SIZE + 16];     //文件名加"./"和".u3vcache"
+    char arrCacheTempName[FILENAME_SIZE + 20];     //缓存文件名加".tmp"
+    snprintf(arrCacheFileName, sizeof(arrCacheFileName), "./%s.u3vcache", arrNameTemp);
+    snprintf(arrCacheTempName, sizeof(arrCacheTempName), "%s.tmp", arrCacheFileName);
+
+    uint64_t ui64ErrorCount = 0;
+    int status = 1;
+    RESULT_CACHE stCache;
+    RESULT_CACHE *pCache = NULL;
+    CACHE_HEADER stCacheKey;
+    if (stOption.bCache && (CacheKeyInit(fpData, stOption, &stCacheKey) == 0))
+    {
+        status = CacheReplay(arrCacheFileName, stCacheKey, fpData, pArrResultFileName, stOption, ui64ErrorCount);
+        if ((status == 1) && (CacheBegin(&stCache, arrCacheTempName, stCacheKey) == 0))
+        {
+            pCache = &stCache;
+        }
+    }
+    if (status == 1)    //不使用缓存或缓存未命中
+    {
+        status = LogAnalysis(fpData, pArrStr, pArrResultFileName, stOption, ui64ErrorCount, pCache);
+        if (pCache != NULL)
+        {
+            CacheFinish(pCache, arrCacheTempName, arrCacheFileName, status == 0, ui64ErrorCount);
+            pCache = NULL;
+        }
+    }
     if (status != 0)
     {
         printf("LogAnalysis Error\n");
     }
-
-    //删除二维数组
-    for (int i = 0; i < CMD_LINE_NUM; ++i)
+    //解析未完成时返回非零
+    int nExitCode = (status != 0) ? 1 : 0;
+    if (stOption.bValidate)
     {
-        delete pArrStr[i];        
+        //作为批量校验的门禁，存在协议错误时同样返回非零
+        nExitCode = ((status != 0) || (ui64ErrorCount != 0)) ? 1 : 0;
+        printf("Validate %s\n", (nExitCode == 0) ? "PASS" : "FAIL");
     }
-    delete pArrStr;
+
+    //删除二维数组
+    FreeModuleBuffer(pArrStr);
     pArrStr = NULL;
 
     fclose(fpData);
     fpData = NULL;
-    return 0;
+    if (stOption.nRawFd >= 0)
+    {
+        close(stOption.nRawFd);
+        stOption.nRawFd = -1;
+    }
+    if (stOption.pPngEncoder != NULL)
+    {
+        PngEncoderRelease(stOption.pPngEncoder);
+        printf("#Png: Frames:%llu Failed:%llu\n", (unsigned long long)stOption.pPngEncoder->ui64EncodedNum, (unsigned long long)stOption.pPngEncoder->ui64FailNum);
+        stOption.pPngEncoder = NULL;
+    }
+    return nExitCode;
 }